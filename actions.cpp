@@ -1,585 +1,1080 @@
-//==============================================================================
-
-#include <hgeresource.h>
-#include <hgefont.h>
-
-#include <engine.hpp>
-#include <viewport.hpp>
-#include <entity.hpp>
-#include <actions.hpp>
-
-//==============================================================================
-ActionTaker::ActionTaker()
-    :
-    m_supported( TYPE_NONE ),
-    m_entity( 0 ),
-    m_actions()
-{
-}
-
-//------------------------------------------------------------------------------
-ActionTaker::~ActionTaker()
-{
-    std::map< ActionType, Action * >::iterator i;
-    for ( i = m_actions.begin(); i != m_actions.end(); )
-    {
-        delete i->second;
-        m_actions.erase( i++ );
-    }
-}
-
-//------------------------------------------------------------------------------
-bool
-ActionTaker::hasAction( ActionType type )
-{
-    return m_actions.find( type ) != m_actions.end();
-}
-
-//------------------------------------------------------------------------------
-Action *
-ActionTaker::getAction( ActionType type )
-{
-    std::map< ActionType, Action * >::iterator i( m_actions.find( type ) );
-    if ( i == m_actions.end() )
-    {
-        return 0;
-    }
-    return i->second;
-}
-
-//------------------------------------------------------------------------------
-void
-ActionTaker::addAction( Action * action )
-{
-    if ( ( action->getType() & m_supported ) == 0 )
-    {
-        Engine::hge()->System_Log( "Action not supported" );
-        return;
-    }
-    Action * oldAction( getAction( action->getType() ) );
-    if ( oldAction != 0 )
-    {
-        Engine::hge()->System_Log( "Stopping old action" );
-        stopAction( oldAction );
-    }
-    action->setEntity( m_entity );
-    m_actions.insert( std::pair< ActionType, Action * >( action->getType(),
-                                                         action ) );
-    action->init();
-}
-
-//------------------------------------------------------------------------------
-void
-ActionTaker::stopAction( Action * action )
-{
-    ActionType type( action->getType() );
-    std::map< ActionType, Action * >::iterator i( m_actions.find( type ) );
-    if ( i == m_actions.end() )
-    {
-        return;
-    }
-    i->second->getEntity()->onActionInterrupted( i->second );
-    delete i->second;
-    m_actions.erase( i );
-}
-
-//------------------------------------------------------------------------------
-//protected::
-//------------------------------------------------------------------------------
-void
-ActionTaker::collideActions( Entity * entity, b2ContactPoint * point )
-{
-    std::map< ActionType, Action * >::iterator i;
-    for ( i = m_actions.begin(); i != m_actions.end(); ++i )
-    {
-        i->second->collide( entity, point );
-    }
-}
-
-//------------------------------------------------------------------------------
-void
-ActionTaker::updateActions( float dt )
-{
-    std::map< ActionType, Action * >::iterator i;
-    for ( i = m_actions.begin(); i != m_actions.end(); )
-    {
-        Action * action( i->second );
-        action->update( dt );
-        if ( ! action->isComplete() )
-        {
-            ++i;
-            continue;
-        }
-        action->getEntity()->onActionCompleted( action );
-        delete action;
-        m_actions.erase( i++ );
-    }
-}
-
-//------------------------------------------------------------------------------
-void
-ActionTaker::renderActions()
-{
-    std::map< ActionType, Action * >::iterator i;
-    for ( i = m_actions.begin(); i != m_actions.end(); ++i )
-    {
-        i->second->render();
-    }
-}
-
-//==============================================================================
-Action::Action( Target * target )
-    :
-    m_entity( 0 ),
-    m_target( target ),
-    m_type( TYPE_NONE ),
-    m_complete( false )
-{
-}
-
-//------------------------------------------------------------------------------
-Action::~Action()
-{
-    delete m_target;
-}
-
-//------------------------------------------------------------------------------
-bool
-Action::isComplete()
-{
-    return m_complete;
-}
-
-//------------------------------------------------------------------------------
-ActionType
-Action::getType()
-{
-    return m_type;
-}
-
-//------------------------------------------------------------------------------
-Target *
-Action::getTarget()
-{
-    return m_target;
-}
-
-//------------------------------------------------------------------------------
-//static:
-//------------------------------------------------------------------------------
-Action *
-Action::factory( ActionType type, Target * target )
-{
-    switch ( type )
-    {
-        case TYPE_MOVE:
-        {
-            return new MoveAction( target );
-        }
-        case TYPE_HALT:
-        {
-            return new HaltAction( target );
-        }
-        case TYPE_INVESTIGATE:
-        {
-            return new InfoAction( target );
-        }
-        case TYPE_RESCUE:
-        {
-            return new RescueAction( target );
-        }
-        case TYPE_ATTACK:
-        {
-            return new AttackAction( target );
-        }
-        case TYPE_AIRSTRIKE:
-        {
-            return new StrikeAction( target );
-        }
-    }
-    return 0;
-}
-
-//------------------------------------------------------------------------------
-//protected:
-//------------------------------------------------------------------------------
-void
-Action::setEntity( Entity * entity )
-{
-    m_entity = entity;
-}
-
-//------------------------------------------------------------------------------
-Entity *
-Action::getEntity()
-{
-    return m_entity;
-}
-
-//==============================================================================
-Target::Target( Entity * entity )
-    :
-    m_entity( entity ),
-    m_position( 0.0f, 0.0f )
-{
-}
-
-//------------------------------------------------------------------------------
-Target::Target( b2Vec2 position )
-    :
-    m_entity( 0 ),
-    m_position( position )
-{
-}
-
-//------------------------------------------------------------------------------
-Target::~Target()
-{
-}
-
-//------------------------------------------------------------------------------
-const b2Vec2 &
-Target::getPosition()
-{
-    if ( m_entity != 0 )
-    {
-        return m_entity->getBody()->GetPosition();
-    }
-    return m_position;
-}
-
-//------------------------------------------------------------------------------
-Entity *
-Target::getEntity()
-{
-    return m_entity;
-}
-
-//==============================================================================
-MoveAction::MoveAction( Target * target )
-    :
-    Action( target )
-{
-    m_type = TYPE_MOVE;
-}
-
-//------------------------------------------------------------------------------
-MoveAction::~MoveAction()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-MoveAction::init()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-MoveAction::collide( Entity * entity, b2ContactPoint * point )
-{
-    if ( m_target->getEntity() == 0 ||
-         entity->getType() != m_target->getEntity()->getType() )
-    {
-        return;
-    }
-    if ( entity->getType() == TYPE_BUILDING )
-    {
-        if ( static_cast< Building * >( entity )->getMeta() ==
-             static_cast< Building * >( m_target->getEntity() )->getMeta() )
-        {
-            _completeAction();
-        }
-    }
-    else if ( entity->getType() == TYPE_CAR )
-    {
-        if ( entity == m_target->getEntity() )
-        {
-            _completeAction();
-        }
-    }
-    else if ( entity == m_target->getEntity() )
-    {
-        _completeAction();
-    }
-}
-
-//------------------------------------------------------------------------------
-void
-MoveAction::update( float dt )
-{
-    m_entity->getBody()->WakeUp();
-
-    b2Vec2 position( m_entity->getBody()->GetPosition() );
-    b2Vec2 direction( m_target->getPosition() - position );
-    float length( direction.Normalize() );
-    b2Vec2 vertical( 0.0f, -1.0f );
-    b2Mat22 rotation( m_entity->getBody()->GetAngle() );
-    b2Vec2 heading( b2Mul( rotation, vertical ) );
-
-    if ( length < 2.0f )
-    {
-        _completeAction();
-        return;
-    }
-
-    // Perturb this to avoid collisions with obstacles
-
-    /*
-    b2AABB aabb;
-    b2Vec2 range( 100.0f, 100.0f );
-    aabb.lowerBound = m_entity->getBody()->GetPosition() - range;
-    aabb.upperBound = m_entity->getBody()->GetPosition() + range;
-    b2Shape * shapes[100];
-    int num( Engine::b2d()->Query( aabb, shapes, 100 ) );
-    bool done( false );
-    for ( int i = 0; i < num; ++ i )
-    {
-        b2Shape * shape( shapes[i] );
-        Entity * entity( static_cast< Entity * >(
-            shape->GetBody()->GetUserData() ) );
-        if ( entity == m_entity )
-        {
-            continue;
-        }
-        if ( m_target->getEntity() == entity )
-        {
-            done = true;
-        }
-    }
-    */
-
-    float magnitude( 0.5f * ( 1.0f - b2Dot( heading, direction ) ) );
-    m_entity->getBody()->SetLinearVelocity(
-        10.0f * ( 1.0f - magnitude ) * heading );
-    m_entity->getBody()->SetAngularVelocity(
-        10.0f * magnitude * b2Cross( heading, direction ) );
-}
-
-//------------------------------------------------------------------------------
-void
-MoveAction::render()
-{
-    return;
-    b2Vec2 position( m_entity->getBody()->GetPosition() );
-    Engine::hge()->Gfx_RenderLine( position.x, position.y,
-                                   m_target->getPosition().x,
-                                   m_target->getPosition().y, 0xAAFFFF55 );
-    hgeFont * font( Engine::rm()->GetFont( "dialogue" ) );
-    font->SetScale( 1.0f / Engine::vp()->hscale() );
-    b2Body * body( m_entity->getBody() );
-    if ( isComplete() )
-    {
-        font->printf( body->GetPosition().x, body->GetPosition().y,
-                      HGETEXT_CENTER, "[complete]" );
-    }
-    else
-    {
-        font->printf( body->GetPosition().x, body->GetPosition().y + 15.0f,
-                      HGETEXT_CENTER, "[moving]" );
-    }
-    font->SetScale( 1.0f );
-}
-
-//------------------------------------------------------------------------------
-//private:
-//------------------------------------------------------------------------------
-void
-MoveAction::_completeAction()
-{
-    m_complete = true;
-    m_entity->getBody()->SetAngularVelocity( 0.0f );
-    b2Vec2 zero( 0.0f, 0.0f );
-    m_entity->getBody()->SetLinearVelocity( zero );
-}
-
-//==============================================================================
-HaltAction::HaltAction( Target * target )
-    :
-    Action( target )
-{
-    m_type = TYPE_HALT;
-}
-
-//------------------------------------------------------------------------------
-HaltAction::~HaltAction()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-HaltAction::init()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-HaltAction::collide( Entity * entity, b2ContactPoint * point )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-HaltAction::update( float dt )
-{
-    m_complete = true;
-    m_entity->getBody()->SetAngularVelocity( 0.0f );
-    b2Vec2 zero( 0.0f, 0.0f );
-    m_entity->getBody()->SetLinearVelocity( zero );
-}
-
-//------------------------------------------------------------------------------
-void
-HaltAction::render()
-{
-}
-
-//==============================================================================
-InfoAction::InfoAction( Target * target )
-    :
-    Action( target )
-{
-    m_type = TYPE_INVESTIGATE;
-}
-
-//------------------------------------------------------------------------------
-InfoAction::~InfoAction()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-InfoAction::init()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-InfoAction::collide( Entity * entity, b2ContactPoint * point )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-InfoAction::update( float dt )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-InfoAction::render()
-{
-}
-
-//==============================================================================
-RescueAction::RescueAction( Target * target )
-    :
-    Action( target )
-{
-    m_type = TYPE_RESCUE;
-}
-
-//------------------------------------------------------------------------------
-RescueAction::~RescueAction()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-RescueAction::init()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-RescueAction::collide( Entity * entity, b2ContactPoint * point )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-RescueAction::update( float dt )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-RescueAction::render()
-{
-}
-
-//==============================================================================
-AttackAction::AttackAction( Target * target )
-    :
-    Action( target )
-{
-    m_type = TYPE_ATTACK;
-}
-
-//------------------------------------------------------------------------------
-AttackAction::~AttackAction()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-AttackAction::init()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-AttackAction::collide( Entity * entity, b2ContactPoint * point )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-AttackAction::update( float dt )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-AttackAction::render()
-{
-}
-
-//==============================================================================
-StrikeAction::StrikeAction( Target * target )
-    :
-    Action( target )
-{
-    m_type = TYPE_AIRSTRIKE;
-}
-
-//------------------------------------------------------------------------------
-StrikeAction::~StrikeAction()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-StrikeAction::init()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-StrikeAction::collide( Entity * entity, b2ContactPoint * point )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-StrikeAction::update( float dt )
-{
-}
-
-//------------------------------------------------------------------------------
-void
-StrikeAction::render()
-{
-}
-
-//==============================================================================
+//==============================================================================
+
+#include <hgeresource.h>
+#include <hgefont.h>
+
+#include <engine.hpp>
+#include <viewport.hpp>
+#include <entity.hpp>
+#include <actions.hpp>
+#include <navigation.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const float WAYPOINT_RADIUS( 5.0f );
+    const float REPLAN_DISTANCE( 20.0f );
+    const float REPLAN_DELAY( 0.5f );
+    const int FLOW_SHARED( 3 );
+    const float ROUTE_DISTANCE( 500.0f );
+    const float SLOT_SPACING( 20.0f );
+    const float SLOT_RADIUS( 4.0f );
+    const float FOLLOW_DISTANCE( 60.0f );
+    const float SETTLE_TIME( 3.0f );
+
+    struct SlotPair
+    {
+        float distance;
+        int member;
+        int slot;
+    };
+};
+
+//==============================================================================
+ActionTaker::ActionTaker()
+    :
+    m_supported( TYPE_NONE ),
+    m_entity( 0 ),
+    m_actions()
+{
+}
+
+//------------------------------------------------------------------------------
+ActionTaker::~ActionTaker()
+{
+    clearActions();
+}
+
+//------------------------------------------------------------------------------
+bool
+ActionTaker::hasAction( ActionType type )
+{
+    return m_actions.find( type ) != m_actions.end();
+}
+
+//------------------------------------------------------------------------------
+Action *
+ActionTaker::getAction( ActionType type )
+{
+    std::map< ActionType, Action * >::iterator i( m_actions.find( type ) );
+    if ( i == m_actions.end() )
+    {
+        return 0;
+    }
+    return i->second;
+}
+
+//------------------------------------------------------------------------------
+void
+ActionTaker::addAction( Action * action )
+{
+    if ( ( action->getType() & m_supported ) == 0 )
+    {
+        Engine::hge()->System_Log( "Action not supported" );
+        return;
+    }
+    Action * oldAction( getAction( action->getType() ) );
+    if ( oldAction != 0 )
+    {
+        Engine::hge()->System_Log( "Stopping old action" );
+        stopAction( oldAction );
+    }
+    action->setEntity( m_entity );
+    m_actions.insert( std::pair< ActionType, Action * >( action->getType(),
+                                                         action ) );
+    action->init();
+}
+
+//------------------------------------------------------------------------------
+void
+ActionTaker::stopAction( Action * action )
+{
+    ActionType type( action->getType() );
+    std::map< ActionType, Action * >::iterator i( m_actions.find( type ) );
+    if ( i == m_actions.end() )
+    {
+        return;
+    }
+    i->second->getEntity()->onActionInterrupted( i->second );
+    delete i->second;
+    m_actions.erase( i );
+}
+
+//------------------------------------------------------------------------------
+void
+ActionTaker::clearActions()
+{
+    std::map< ActionType, Action * >::iterator i;
+    for ( i = m_actions.begin(); i != m_actions.end(); )
+    {
+        delete i->second;
+        m_actions.erase( i++ );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Interrupts anything aimed at an entity that's about to be deleted, so that
+// no target is left pointing at it.
+void
+ActionTaker::forgetEntity( Entity * entity )
+{
+    std::map< ActionType, Action * >::iterator i;
+    for ( i = m_actions.begin(); i != m_actions.end(); )
+    {
+        Target * target( i->second->getTarget() );
+        if ( target != 0 && target->getEntity() == entity )
+        {
+            i->second->getEntity()->onActionInterrupted( i->second );
+            delete i->second;
+            m_actions.erase( i++ );
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//protected::
+//------------------------------------------------------------------------------
+void
+ActionTaker::collideActions( Entity * entity, b2ContactPoint * point )
+{
+    std::map< ActionType, Action * >::iterator i;
+    for ( i = m_actions.begin(); i != m_actions.end(); ++i )
+    {
+        i->second->collide( entity, point );
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+ActionTaker::updateActions( float dt )
+{
+    std::map< ActionType, Action * >::iterator i;
+    for ( i = m_actions.begin(); i != m_actions.end(); )
+    {
+        Action * action( i->second );
+        action->update( dt );
+        if ( ! action->isComplete() )
+        {
+            ++i;
+            continue;
+        }
+        action->getEntity()->onActionCompleted( action );
+        delete action;
+        m_actions.erase( i++ );
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+ActionTaker::renderActions()
+{
+    std::map< ActionType, Action * >::iterator i;
+    for ( i = m_actions.begin(); i != m_actions.end(); ++i )
+    {
+        i->second->render();
+    }
+}
+
+//==============================================================================
+Action::Action( Target * target )
+    :
+    m_entity( 0 ),
+    m_target( target ),
+    m_type( TYPE_NONE ),
+    m_complete( false ),
+    m_abandoned( false )
+{
+}
+
+//------------------------------------------------------------------------------
+Action::~Action()
+{
+    delete m_target;
+}
+
+//------------------------------------------------------------------------------
+bool
+Action::isComplete()
+{
+    return m_complete;
+}
+
+//------------------------------------------------------------------------------
+// Completed by giving up, rather than by getting there.
+bool
+Action::isAbandoned()
+{
+    return m_abandoned;
+}
+
+//------------------------------------------------------------------------------
+ActionType
+Action::getType()
+{
+    return m_type;
+}
+
+//------------------------------------------------------------------------------
+Target *
+Action::getTarget()
+{
+    return m_target;
+}
+
+//------------------------------------------------------------------------------
+//static:
+//------------------------------------------------------------------------------
+Action *
+Action::factory( ActionType type, Target * target )
+{
+    switch ( type )
+    {
+        case TYPE_MOVE:
+        {
+            return new MoveAction( target );
+        }
+        case TYPE_HALT:
+        {
+            return new HaltAction( target );
+        }
+        case TYPE_INVESTIGATE:
+        {
+            return new InfoAction( target );
+        }
+        case TYPE_RESCUE:
+        {
+            return new RescueAction( target );
+        }
+        case TYPE_ATTACK:
+        {
+            return new AttackAction( target );
+        }
+        case TYPE_AIRSTRIKE:
+        {
+            return new StrikeAction( target );
+        }
+    }
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+//protected:
+//------------------------------------------------------------------------------
+void
+Action::setEntity( Entity * entity )
+{
+    m_entity = entity;
+}
+
+//------------------------------------------------------------------------------
+Entity *
+Action::getEntity()
+{
+    return m_entity;
+}
+
+//==============================================================================
+Target::Target( Entity * entity )
+    :
+    m_entity( entity != 0 ? entity->getHandle() : 0 ),
+    m_position( 0.0f, 0.0f )
+{
+    if ( entity != 0 )
+    {
+        m_position = entity->getBody()->GetPosition();
+    }
+}
+
+//------------------------------------------------------------------------------
+Target::Target( b2Vec2 position )
+    :
+    m_entity( 0 ),
+    m_position( position )
+{
+}
+
+//------------------------------------------------------------------------------
+Target::~Target()
+{
+}
+
+//------------------------------------------------------------------------------
+// Follows the entity for as long as it's around, and stays wherever it was last
+// seen once it's gone.
+const b2Vec2 &
+Target::getPosition()
+{
+    Entity * entity( Entity::lookup( m_entity ) );
+    if ( entity != 0 )
+    {
+        m_position = entity->getBody()->GetPosition();
+    }
+    return m_position;
+}
+
+//------------------------------------------------------------------------------
+Entity *
+Target::getEntity()
+{
+    return Entity::lookup( m_entity );
+}
+
+//==============================================================================
+GroupOrder::GroupOrder( Target * target,
+                        const std::vector< Entity * > & members )
+    :
+    m_references( 0 ),
+    m_target( target ),
+    m_leader( 0 ),
+    m_anchored( false ),
+    m_offsets(),
+    m_slots()
+{
+    _form( members );
+    _assign( members );
+}
+
+//------------------------------------------------------------------------------
+GroupOrder::~GroupOrder()
+{
+    delete m_target;
+}
+
+//------------------------------------------------------------------------------
+void
+GroupOrder::retain()
+{
+    m_references += 1;
+}
+
+//------------------------------------------------------------------------------
+void
+GroupOrder::release()
+{
+    m_references -= 1;
+    if ( m_references <= 0 )
+    {
+        delete this;
+    }
+}
+
+//------------------------------------------------------------------------------
+Target *
+GroupOrder::getTarget()
+{
+    return m_target;
+}
+
+//------------------------------------------------------------------------------
+int
+GroupOrder::getSlot( int member )
+{
+    return m_slots[member];
+}
+
+//------------------------------------------------------------------------------
+// Slots are laid out around the leader while it's on its way, and around the
+// target once it's there. We also anchor on the target if the leader is lost.
+b2Vec2
+GroupOrder::getPosition( int slot )
+{
+    if ( ! m_anchored )
+    {
+        Entity * leader( Entity::lookup( m_leader ) );
+        if ( leader != 0 && leader->getBody() != 0 )
+        {
+            return leader->getBody()->GetPosition() + m_offsets[slot];
+        }
+        m_anchored = true;
+    }
+    return m_target->getPosition() + m_offsets[slot];
+}
+
+//------------------------------------------------------------------------------
+bool
+GroupOrder::isAnchored()
+{
+    return m_anchored;
+}
+
+//------------------------------------------------------------------------------
+void
+GroupOrder::anchor()
+{
+    m_anchored = true;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+// The wedge points from the middle of the group towards the target, with the
+// point slot first and the rest alternating left and right, one rank further
+// back each pair.
+void
+GroupOrder::_form( const std::vector< Entity * > & members )
+{
+    b2Vec2 centre( 0.0f, 0.0f );
+    std::vector< Entity * >::const_iterator i;
+    for ( i = members.begin(); i != members.end(); ++i )
+    {
+        centre += ( * i )->getBody()->GetPosition();
+    }
+    if ( members.size() > 0 )
+    {
+        centre *= 1.0f / static_cast< float >( members.size() );
+    }
+
+    b2Vec2 forward( m_target->getPosition() - centre );
+    if ( forward.Normalize() < B2_FLT_EPSILON )
+    {
+        forward.Set( 0.0f, -1.0f );
+    }
+    b2Vec2 across( -forward.y, forward.x );
+
+    m_offsets.clear();
+    for ( unsigned int slot = 0; slot < members.size(); ++slot )
+    {
+        float rank( static_cast< float >( ( slot + 1 ) / 2 ) * SLOT_SPACING );
+        float side( slot % 2 == 1 ? -rank : rank );
+        m_offsets.push_back( -rank * forward + side * across );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Matches members to the slots they'll have at the target, taking the closest
+// pair that's left each time. It's not the best matching there is, but groups
+// are small and it keeps anyone from crossing the whole group to get to theirs.
+void
+GroupOrder::_assign( const std::vector< Entity * > & members )
+{
+    int count( static_cast< int >( members.size() ) );
+    b2Vec2 goal( m_target->getPosition() );
+    std::vector< SlotPair > pairs;
+    pairs.reserve( count * count );
+    for ( int i = 0; i < count; ++i )
+    {
+        b2Vec2 position( members[i]->getBody()->GetPosition() );
+        for ( int j = 0; j < count; ++j )
+        {
+            SlotPair pair;
+            pair.distance = ( goal + m_offsets[j] - position ).LengthSquared();
+            pair.member = i;
+            pair.slot = j;
+            pairs.push_back( pair );
+        }
+    }
+
+    m_slots.assign( count, -1 );
+    std::vector< bool > taken( count, false );
+    for ( int n = 0; n < count; ++n )
+    {
+        int best( -1 );
+        for ( unsigned int k = 0; k < pairs.size(); ++k )
+        {
+            const SlotPair & pair( pairs[k] );
+            if ( m_slots[pair.member] >= 0 || taken[pair.slot] )
+            {
+                continue;
+            }
+            if ( best < 0 || pair.distance < pairs[best].distance )
+            {
+                best = k;
+            }
+        }
+        m_slots[pairs[best].member] = pairs[best].slot;
+        taken[pairs[best].slot] = true;
+        if ( pairs[best].slot == 0 )
+        {
+            m_leader = members[pairs[best].member]->getHandle();
+        }
+    }
+}
+
+//==============================================================================
+MoveAction::MoveAction( Target * target )
+    :
+    Action( target ),
+    m_route(),
+    m_leg( 0 ),
+    m_path(),
+    m_waypoint( 0 ),
+    m_goal( 0.0f, 0.0f ),
+    m_replan( 0.0f ),
+    m_flow( 0 ),
+    m_area(),
+    m_shared( false ),
+    m_group( 0 ),
+    m_slot( 0 ),
+    m_settle( 0.0f )
+{
+    m_type = TYPE_MOVE;
+}
+
+//------------------------------------------------------------------------------
+MoveAction::MoveAction( GroupOrder * group, int slot )
+    :
+    Action( group->getTarget() ),
+    m_route(),
+    m_leg( 0 ),
+    m_path(),
+    m_waypoint( 0 ),
+    m_goal( 0.0f, 0.0f ),
+    m_replan( 0.0f ),
+    m_flow( 0 ),
+    m_area(),
+    m_shared( false ),
+    m_group( group ),
+    m_slot( slot ),
+    m_settle( 0.0f )
+{
+    m_type = TYPE_MOVE;
+    m_group->retain();
+}
+
+//------------------------------------------------------------------------------
+// The target belongs to the group, so it mustn't go with us.
+MoveAction::~MoveAction()
+{
+    _release();
+    if ( m_group != 0 )
+    {
+        if ( m_slot == 0 )
+        {
+            m_group->anchor();
+        }
+        m_target = 0;
+        m_group->release();
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::init()
+{
+    // Occupants are out of the physics world, so they have to get out before
+    // they can go anywhere.
+    Container * container( m_entity->getContainer() );
+    if ( container != 0 )
+    {
+        container->leave( m_entity );
+    }
+    if ( m_group == 0 || m_slot == 0 )
+    {
+        _plan();
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::collide( Entity * entity, b2ContactPoint * point )
+{
+    if ( m_target->getEntity() == 0 ||
+         entity->getType() != m_target->getEntity()->getType() )
+    {
+        return;
+    }
+    if ( entity->getType() == TYPE_BUILDING )
+    {
+        if ( static_cast< Building * >( entity )->getMeta() ==
+             static_cast< Building * >( m_target->getEntity() )->getMeta() )
+        {
+            _completeAction();
+        }
+    }
+    else if ( entity->getType() == TYPE_CAR )
+    {
+        if ( entity == m_target->getEntity() )
+        {
+            _completeAction();
+        }
+    }
+    else if ( entity == m_target->getEntity() )
+    {
+        _completeAction();
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::update( float dt )
+{
+    m_entity->getBody()->WakeUp();
+
+    if ( m_group != 0 && m_slot != 0 )
+    {
+        _follow( dt );
+        return;
+    }
+
+    b2Vec2 position( m_entity->getBody()->GetPosition() );
+    b2Vec2 goal( m_target->getPosition() );
+
+    if ( ( goal - position ).Length() < 2.0f )
+    {
+        _completeAction();
+        return;
+    }
+
+    // Targets that wander off get a fresh path, but not every frame.
+    m_replan -= dt;
+    if ( m_replan <= 0.0f &&
+         ( goal - m_goal ).LengthSquared() > REPLAN_DISTANCE * REPLAN_DISTANCE )
+    {
+        _plan();
+    }
+
+    // Once enough units are heading to the same place, they all switch over
+    // to sharing its flow field.
+    NavGrid * nav( Engine::nav() );
+    if ( m_flow != 0 && ! m_shared &&
+         nav->getFlowUsers( m_flow ) >= FLOW_SHARED )
+    {
+        m_shared = true;
+    }
+
+    b2Vec2 waypoint( goal );
+    // The flow gives out in the goal cells, and where the goal can't be
+    // reached, so from there we go back to a path of our own.
+    if ( m_shared && ! nav->followFlow( m_flow, m_area, position, waypoint ) )
+    {
+        _release();
+        _findPath( position );
+    }
+    if ( ! m_shared )
+    {
+        while ( m_waypoint < m_path.size() &&
+                ( m_path[m_waypoint] - position ).Length() < WAYPOINT_RADIUS )
+        {
+            ++m_waypoint;
+        }
+        if ( m_waypoint >= m_path.size() && m_leg < m_route.size() )
+        {
+            _refine( position );
+        }
+        if ( m_waypoint < m_path.size() )
+        {
+            waypoint = m_path[m_waypoint];
+        }
+    }
+
+    _steer( waypoint );
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::render()
+{
+    return;
+    b2Vec2 position( m_entity->getBody()->GetPosition() );
+    Engine::hge()->Gfx_RenderLine( position.x, position.y,
+                                   m_target->getPosition().x,
+                                   m_target->getPosition().y, 0xAAFFFF55 );
+    hgeFont * font( Engine::rm()->GetFont( "dialogue" ) );
+    font->SetScale( 1.0f / Engine::vp()->hscale() );
+    b2Body * body( m_entity->getBody() );
+    if ( isComplete() )
+    {
+        font->printf( body->GetPosition().x, body->GetPosition().y,
+                      HGETEXT_CENTER, "[complete]" );
+    }
+    else
+    {
+        font->printf( body->GetPosition().x, body->GetPosition().y + 15.0f,
+                      HGETEXT_CENTER, "[moving]" );
+    }
+    font->SetScale( 1.0f );
+}
+
+//------------------------------------------------------------------------------
+//private:
+//------------------------------------------------------------------------------
+// Buildings and points on the ground are destinations that may be shared, so
+// we sign up for their flow field; moving targets always get a path of their
+// own. Falls back to heading straight for the target if there's no way there.
+void
+MoveAction::_plan()
+{
+    NavGrid * nav( Engine::nav() );
+
+    _release();
+
+    m_goal = m_target->getPosition();
+    m_replan = REPLAN_DELAY;
+    m_route.clear();
+    m_leg = 0;
+    m_waypoint = 0;
+    m_path.clear();
+
+    Entity * entity( m_target->getEntity() );
+    if ( entity == 0 )
+    {
+        int cell( nav->cellAt( m_goal ) );
+        if ( cell >= 0 )
+        {
+            m_flow = NavGrid::pointKey( cell );
+            m_area.lowerBound = m_goal;
+            m_area.upperBound = m_goal;
+        }
+    }
+    else if ( entity->getType() == TYPE_BUILDING )
+    {
+        MetaBuilding * meta( static_cast< Building * >( entity )->getMeta() );
+        m_flow = NavGrid::buildingKey( meta->getOwner()->getIndex() );
+        m_area = meta->getAABB();
+    }
+
+    if ( m_flow != 0 && nav->addFlowUser( m_flow ) >= FLOW_SHARED )
+    {
+        m_shared = true;
+        return;
+    }
+
+    _findPath( m_entity->getBody()->GetPosition() );
+}
+
+//------------------------------------------------------------------------------
+// Long trips are routed across the map first, and each leg of the route is
+// planned on the grid as we come to it.
+void
+MoveAction::_findPath( const b2Vec2 & position )
+{
+    NavGrid * nav( Engine::nav() );
+
+    m_route.clear();
+    m_leg = 0;
+    m_waypoint = 0;
+    m_path.clear();
+
+    if ( ( m_goal - position ).Length() > ROUTE_DISTANCE &&
+         nav->findRoute( position, m_goal, m_route ) )
+    {
+        _refine( position );
+    }
+    else if ( ! nav->findPath( position, m_goal, m_path ) )
+    {
+        m_path.clear();
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::_refine( const b2Vec2 & position )
+{
+    m_waypoint = 0;
+    if ( ! Engine::nav()->findPath( position, m_route[m_leg], m_path ) )
+    {
+        m_path.clear();
+    }
+    m_leg += 1;
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::_release()
+{
+    if ( m_flow != 0 )
+    {
+        Engine::nav()->removeFlowUser( m_flow );
+    }
+    m_flow = 0;
+    m_shared = false;
+}
+
+//------------------------------------------------------------------------------
+// Followers head straight for their slot, and only plan a path to it if they
+// fall far enough behind that something is likely to be in the way. Anyone
+// who is close by but can't get into their slot once the group has arrived
+// gives up on it. Those still on their way keep going, however long it takes.
+void
+MoveAction::_follow( float dt )
+{
+    b2Vec2 position( m_entity->getBody()->GetPosition() );
+    b2Vec2 slot( m_group->getPosition( m_slot ) );
+    float distance( ( slot - position ).Length() );
+
+    if ( m_group->isAnchored() )
+    {
+        if ( distance < FOLLOW_DISTANCE )
+        {
+            m_settle += dt;
+        }
+        if ( distance < SLOT_RADIUS )
+        {
+            _completeAction();
+            return;
+        }
+        if ( m_settle > SETTLE_TIME )
+        {
+            m_abandoned = true;
+            _completeAction();
+            return;
+        }
+    }
+    if ( distance < SLOT_RADIUS )
+    {
+        m_entity->getBody()->SetAngularVelocity( 0.0f );
+        m_entity->getBody()->SetLinearVelocity( b2Vec2( 0.0f, 0.0f ) );
+        return;
+    }
+
+    b2Vec2 waypoint( slot );
+    m_replan -= dt;
+    if ( distance < FOLLOW_DISTANCE )
+    {
+        m_path.clear();
+    }
+    else
+    {
+        if ( m_replan <= 0.0f && ( m_path.size() == 0 ||
+             ( slot - m_goal ).LengthSquared() >
+             REPLAN_DISTANCE * REPLAN_DISTANCE ) )
+        {
+            m_goal = slot;
+            m_replan = REPLAN_DELAY;
+            m_waypoint = 0;
+            if ( ! Engine::nav()->findPath( position, m_goal, m_path ) )
+            {
+                m_path.clear();
+            }
+        }
+        while ( m_waypoint < m_path.size() &&
+                ( m_path[m_waypoint] - position ).Length() < WAYPOINT_RADIUS )
+        {
+            ++m_waypoint;
+        }
+        if ( m_waypoint < m_path.size() )
+        {
+            waypoint = m_path[m_waypoint];
+        }
+    }
+
+    _steer( waypoint );
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::_steer( const b2Vec2 & waypoint )
+{
+    b2Vec2 position( m_entity->getBody()->GetPosition() );
+    b2Vec2 direction( waypoint - position );
+    direction.Normalize();
+    b2Vec2 vertical( 0.0f, -1.0f );
+    b2Mat22 rotation( m_entity->getBody()->GetAngle() );
+    b2Vec2 heading( b2Mul( rotation, vertical ) );
+
+    float magnitude( 0.5f * ( 1.0f - b2Dot( heading, direction ) ) );
+    m_entity->getBody()->SetLinearVelocity(
+        10.0f * ( 1.0f - magnitude ) * heading );
+    m_entity->getBody()->SetAngularVelocity(
+        10.0f * magnitude * b2Cross( heading, direction ) );
+}
+
+//------------------------------------------------------------------------------
+void
+MoveAction::_completeAction()
+{
+    if ( m_group != 0 && m_slot == 0 )
+    {
+        m_group->anchor();
+    }
+    m_complete = true;
+    m_entity->getBody()->SetAngularVelocity( 0.0f );
+    b2Vec2 zero( 0.0f, 0.0f );
+    m_entity->getBody()->SetLinearVelocity( zero );
+}
+
+//==============================================================================
+HaltAction::HaltAction( Target * target )
+    :
+    Action( target )
+{
+    m_type = TYPE_HALT;
+}
+
+//------------------------------------------------------------------------------
+HaltAction::~HaltAction()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+HaltAction::init()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+HaltAction::collide( Entity * entity, b2ContactPoint * point )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+HaltAction::update( float dt )
+{
+    m_complete = true;
+    m_entity->getBody()->SetAngularVelocity( 0.0f );
+    b2Vec2 zero( 0.0f, 0.0f );
+    m_entity->getBody()->SetLinearVelocity( zero );
+}
+
+//------------------------------------------------------------------------------
+void
+HaltAction::render()
+{
+}
+
+//==============================================================================
+InfoAction::InfoAction( Target * target )
+    :
+    Action( target )
+{
+    m_type = TYPE_INVESTIGATE;
+}
+
+//------------------------------------------------------------------------------
+InfoAction::~InfoAction()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+InfoAction::init()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+InfoAction::collide( Entity * entity, b2ContactPoint * point )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+InfoAction::update( float dt )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+InfoAction::render()
+{
+}
+
+//==============================================================================
+RescueAction::RescueAction( Target * target )
+    :
+    Action( target )
+{
+    m_type = TYPE_RESCUE;
+}
+
+//------------------------------------------------------------------------------
+RescueAction::~RescueAction()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+RescueAction::init()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+RescueAction::collide( Entity * entity, b2ContactPoint * point )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+RescueAction::update( float dt )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+RescueAction::render()
+{
+}
+
+//==============================================================================
+AttackAction::AttackAction( Target * target )
+    :
+    Action( target )
+{
+    m_type = TYPE_ATTACK;
+}
+
+//------------------------------------------------------------------------------
+AttackAction::~AttackAction()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+AttackAction::init()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+AttackAction::collide( Entity * entity, b2ContactPoint * point )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+AttackAction::update( float dt )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+AttackAction::render()
+{
+}
+
+//==============================================================================
+StrikeAction::StrikeAction( Target * target )
+    :
+    Action( target )
+{
+    m_type = TYPE_AIRSTRIKE;
+}
+
+//------------------------------------------------------------------------------
+StrikeAction::~StrikeAction()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+StrikeAction::init()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+StrikeAction::collide( Entity * entity, b2ContactPoint * point )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+StrikeAction::update( float dt )
+{
+}
+
+//------------------------------------------------------------------------------
+void
+StrikeAction::render()
+{
+}
+
+//==============================================================================
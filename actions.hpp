@@ -1,223 +1,291 @@
-//==============================================================================
-
-#ifndef ArseDo
-#define ArseDo
-
-#include <vector>
-#include <map>
-
-class Entity;
-class Action;
-class Target;
-
-enum ActionType
-{
-    TYPE_NONE = 0,
-    TYPE_MOVE = 1,
-    TYPE_HALT = 2,
-    TYPE_INVESTIGATE = 3,
-    TYPE_RESCUE = 4,
-    TYPE_ATTACK = 5,
-    TYPE_AIRSTRIKE = 6
-};
-
-//------------------------------------------------------------------------------
-class ActionTaker
-{
-  public:
-    ActionTaker();
-    virtual ~ActionTaker();
-
-    bool hasAction( ActionType type );
-    Action * getAction( ActionType type );
-    void addAction( Action * action );
-    void stopAction( Action * action );
-
-  protected:
-    ActionTaker( const ActionTaker & );
-    ActionTaker & operator=( const ActionTaker & );
-
-  protected:
-    void collideActions( Entity * entity, b2ContactPoint * point );
-    void updateActions( float dt );
-    void renderActions();
-
-  protected:
-    ActionType m_supported;
-    Entity * m_entity;
-
-  private:
-    std::map< ActionType, Action * > m_actions;
-};
-
-//------------------------------------------------------------------------------
-class Action
-{
-  public:
-    Action( Target * target );
-    virtual ~Action();
-
-    virtual void init() = 0;
-    virtual void collide( Entity * entity, b2ContactPoint * point ) = 0;
-    virtual void update( float dt ) = 0;
-    virtual void render() = 0;
-
-    static Action * factory( ActionType type, Target * target );
-
-    bool isComplete();
-
-    ActionType getType();
-    Target * getTarget();
-
-  protected:
-    Action( const Action & );
-    Action & operator=( const Action & );
-
-  protected:
-    friend class ActionTaker;
-    void setEntity( Entity * entity );
-    Entity * getEntity();
-
-  protected:
-    Entity * m_entity;
-    Target * m_target;
-    ActionType m_type;
-    bool m_complete;
-};
-
-//------------------------------------------------------------------------------
-class Target
-{
-  public:
-    Target( Entity * entity );
-    Target( b2Vec2 position );
-    virtual ~Target();
-
-    const b2Vec2 & getPosition();
-    Entity * getEntity();
-
-  protected:
-    Target( const Target & );
-    Target & operator=( const Target & );
-
-  private:
-    Entity * m_entity;
-    b2Vec2 m_position;
-};
-
-//------------------------------------------------------------------------------
-class MoveAction : public Action
-{
-  public:
-    MoveAction( Target * target );
-    virtual ~MoveAction();
-
-    virtual void init();
-    virtual void collide( Entity * entity, b2ContactPoint * point );
-    virtual void update( float dt );
-    virtual void render();
-
-  protected:
-    MoveAction( const MoveAction & );
-    MoveAction & operator=( const MoveAction & );
-
-  private:
-    void _completeAction();
-};
-
-//------------------------------------------------------------------------------
-class HaltAction : public Action
-{
-  public:
-    HaltAction( Target * target );
-    virtual ~HaltAction();
-
-    virtual void init();
-    virtual void collide( Entity * entity, b2ContactPoint * point );
-    virtual void update( float dt );
-    virtual void render();
-
-  protected:
-    HaltAction( const HaltAction & );
-    HaltAction & operator=( const HaltAction & );
-};
-
-//------------------------------------------------------------------------------
-class InfoAction : public Action
-{
-  public:
-    InfoAction( Target * target );
-    virtual ~InfoAction();
-
-    virtual void init();
-    virtual void collide( Entity * entity, b2ContactPoint * point );
-    virtual void update( float dt );
-    virtual void render();
-
-  protected:
-    InfoAction( const InfoAction & );
-    InfoAction & operator=( const InfoAction & );
-
-  private:
-};
-
-//------------------------------------------------------------------------------
-class RescueAction : public Action
-{
-  public:
-    RescueAction( Target * target );
-    virtual ~RescueAction();
-
-    virtual void init();
-    virtual void collide( Entity * entity, b2ContactPoint * point );
-    virtual void update( float dt );
-    virtual void render();
-
-  protected:
-    RescueAction( const RescueAction & );
-    RescueAction & operator=( const RescueAction & );
-
-  private:
-};
-
-//------------------------------------------------------------------------------
-class AttackAction : public Action
-{
-  public:
-    AttackAction( Target * target );
-    virtual ~AttackAction();
-
-    virtual void init();
-    virtual void collide( Entity * entity, b2ContactPoint * point );
-    virtual void update( float dt );
-    virtual void render();
-
-  protected:
-    AttackAction( const AttackAction & );
-    AttackAction & operator=( const AttackAction & );
-
-  private:
-};
-
-//------------------------------------------------------------------------------
-class StrikeAction : public Action
-{
-  public:
-    StrikeAction( Target * target );
-    virtual ~StrikeAction();
-
-    virtual void init();
-    virtual void collide( Entity * entity, b2ContactPoint * point );
-    virtual void update( float dt );
-    virtual void render();
-
-  protected:
-    StrikeAction( const StrikeAction & );
-    StrikeAction & operator=( const StrikeAction & );
-
-  private:
-};
-
-#endif
-
-//==============================================================================
+//==============================================================================
+
+#ifndef ArseDo
+#define ArseDo
+
+#include <vector>
+#include <map>
+
+#include <handles.hpp>
+
+class Entity;
+class Action;
+class Target;
+class GroupOrder;
+
+enum ActionType
+{
+    TYPE_NONE = 0,
+    TYPE_MOVE = 1,
+    TYPE_HALT = 2,
+    TYPE_INVESTIGATE = 3,
+    TYPE_RESCUE = 4,
+    TYPE_ATTACK = 5,
+    TYPE_AIRSTRIKE = 6
+};
+
+//------------------------------------------------------------------------------
+class ActionTaker
+{
+  public:
+    ActionTaker();
+    virtual ~ActionTaker();
+
+    bool hasAction( ActionType type );
+    Action * getAction( ActionType type );
+    void addAction( Action * action );
+    void stopAction( Action * action );
+    void clearActions();
+    void forgetEntity( Entity * entity );
+
+  protected:
+    ActionTaker( const ActionTaker & );
+    ActionTaker & operator=( const ActionTaker & );
+
+  protected:
+    void collideActions( Entity * entity, b2ContactPoint * point );
+    void updateActions( float dt );
+    void renderActions();
+
+  protected:
+    ActionType m_supported;
+    Entity * m_entity;
+
+  private:
+    std::map< ActionType, Action * > m_actions;
+};
+
+//------------------------------------------------------------------------------
+class Action
+{
+  public:
+    Action( Target * target );
+    virtual ~Action();
+
+    virtual void init() = 0;
+    virtual void collide( Entity * entity, b2ContactPoint * point ) = 0;
+    virtual void update( float dt ) = 0;
+    virtual void render() = 0;
+
+    static Action * factory( ActionType type, Target * target );
+
+    bool isComplete();
+    bool isAbandoned();
+
+    ActionType getType();
+    Target * getTarget();
+
+  protected:
+    Action( const Action & );
+    Action & operator=( const Action & );
+
+  protected:
+    friend class ActionTaker;
+    void setEntity( Entity * entity );
+    Entity * getEntity();
+
+  protected:
+    Entity * m_entity;
+    Target * m_target;
+    ActionType m_type;
+    bool m_complete;
+    bool m_abandoned;
+};
+
+//------------------------------------------------------------------------------
+class Target
+{
+  public:
+    Target( Entity * entity );
+    Target( b2Vec2 position );
+    virtual ~Target();
+
+    const b2Vec2 & getPosition();
+    Entity * getEntity();
+
+  protected:
+    Target( const Target & );
+    Target & operator=( const Target & );
+
+  private:
+    EntityHandle m_entity;
+    b2Vec2 m_position;
+};
+
+//------------------------------------------------------------------------------
+// A move given to several units at once. They share the one target, and each
+// is handed a slot in a wedge that points the way the group is heading, with
+// slots matched to whoever is nearest. The unit in the point slot leads, and
+// is the only one to plan a path; the rest keep to their slots around it, and
+// once it arrives they close on their slots around the target instead. The
+// order belongs to the moves that share it, and goes when the last one does.
+class GroupOrder
+{
+  public:
+    GroupOrder( Target * target, const std::vector< Entity * > & members );
+
+  private:
+    ~GroupOrder();
+    GroupOrder( const GroupOrder & );
+    GroupOrder & operator=( const GroupOrder & );
+
+  public:
+    void retain();
+    void release();
+
+    Target * getTarget();
+    int getSlot( int member );
+    b2Vec2 getPosition( int slot );
+    bool isAnchored();
+    void anchor();
+
+  private:
+    void _form( const std::vector< Entity * > & members );
+    void _assign( const std::vector< Entity * > & members );
+
+  private:
+    int m_references;
+    Target * m_target;
+    EntityHandle m_leader;
+    bool m_anchored;
+    std::vector< b2Vec2 > m_offsets;
+    std::vector< int > m_slots;
+};
+
+//------------------------------------------------------------------------------
+class MoveAction : public Action
+{
+  public:
+    MoveAction( Target * target );
+    MoveAction( GroupOrder * group, int slot );
+    virtual ~MoveAction();
+
+    virtual void init();
+    virtual void collide( Entity * entity, b2ContactPoint * point );
+    virtual void update( float dt );
+    virtual void render();
+
+  protected:
+    MoveAction( const MoveAction & );
+    MoveAction & operator=( const MoveAction & );
+
+  private:
+    void _plan();
+    void _findPath( const b2Vec2 & position );
+    void _refine( const b2Vec2 & position );
+    void _release();
+    void _follow( float dt );
+    void _steer( const b2Vec2 & waypoint );
+    void _completeAction();
+
+  private:
+    std::vector< b2Vec2 > m_route;
+    unsigned int m_leg;
+    std::vector< b2Vec2 > m_path;
+    unsigned int m_waypoint;
+    b2Vec2 m_goal;
+    float m_replan;
+    unsigned long long m_flow;
+    b2AABB m_area;
+    bool m_shared;
+    GroupOrder * m_group;
+    int m_slot;
+    float m_settle;
+};
+
+//------------------------------------------------------------------------------
+class HaltAction : public Action
+{
+  public:
+    HaltAction( Target * target );
+    virtual ~HaltAction();
+
+    virtual void init();
+    virtual void collide( Entity * entity, b2ContactPoint * point );
+    virtual void update( float dt );
+    virtual void render();
+
+  protected:
+    HaltAction( const HaltAction & );
+    HaltAction & operator=( const HaltAction & );
+};
+
+//------------------------------------------------------------------------------
+class InfoAction : public Action
+{
+  public:
+    InfoAction( Target * target );
+    virtual ~InfoAction();
+
+    virtual void init();
+    virtual void collide( Entity * entity, b2ContactPoint * point );
+    virtual void update( float dt );
+    virtual void render();
+
+  protected:
+    InfoAction( const InfoAction & );
+    InfoAction & operator=( const InfoAction & );
+
+  private:
+};
+
+//------------------------------------------------------------------------------
+class RescueAction : public Action
+{
+  public:
+    RescueAction( Target * target );
+    virtual ~RescueAction();
+
+    virtual void init();
+    virtual void collide( Entity * entity, b2ContactPoint * point );
+    virtual void update( float dt );
+    virtual void render();
+
+  protected:
+    RescueAction( const RescueAction & );
+    RescueAction & operator=( const RescueAction & );
+
+  private:
+};
+
+//------------------------------------------------------------------------------
+class AttackAction : public Action
+{
+  public:
+    AttackAction( Target * target );
+    virtual ~AttackAction();
+
+    virtual void init();
+    virtual void collide( Entity * entity, b2ContactPoint * point );
+    virtual void update( float dt );
+    virtual void render();
+
+  protected:
+    AttackAction( const AttackAction & );
+    AttackAction & operator=( const AttackAction & );
+
+  private:
+};
+
+//------------------------------------------------------------------------------
+class StrikeAction : public Action
+{
+  public:
+    StrikeAction( Target * target );
+    virtual ~StrikeAction();
+
+    virtual void init();
+    virtual void collide( Entity * entity, b2ContactPoint * point );
+    virtual void update( float dt );
+    virtual void render();
+
+  protected:
+    StrikeAction( const StrikeAction & );
+    StrikeAction & operator=( const StrikeAction & );
+
+  private:
+};
+
+#endif
+
+//==============================================================================
@@ -0,0 +1,371 @@
+//==============================================================================
+
+#include <map>
+#include <algorithm>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <engine.hpp>
+#include <entity.hpp>
+#include <cache.hpp>
+#include <navigation.hpp>
+
+//------------------------------------------------------------------------------
+WorldCache::WorldCache()
+    :
+    m_loaded( false ),
+    m_stale( false ),
+    m_cars(),
+    m_trees(),
+    m_guys(),
+    m_buildings(),
+    m_parked(),
+    m_squad(),
+    m_entities(),
+    m_states()
+{
+}
+
+//------------------------------------------------------------------------------
+WorldCache::~WorldCache()
+{
+    flush();
+}
+
+//------------------------------------------------------------------------------
+// Once an entity has been released the cache can no longer put the world back
+// as it was, so it reports itself unloaded and the next mission loads afresh.
+bool
+WorldCache::isLoaded()
+{
+    return m_loaded && ! m_stale;
+}
+
+//------------------------------------------------------------------------------
+void
+WorldCache::load()
+{
+    flush();
+
+    Entity::resetNextGroupIndex();
+
+    std::vector< Entity * > entities;
+    std::vector< Entity * >::iterator i;
+
+    entities = Entity::databaseFactory( TYPE_BUILDING );
+    for ( i = entities.begin(); i != entities.end(); ++i )
+    {
+        m_buildings.push_back( static_cast< Building * >( * i ) );
+        m_entities.push_back( * i );
+    }
+    _fuseBuildings();
+    entities = Entity::databaseFactory( TYPE_TREE );
+    for ( i = entities.begin(); i != entities.end(); ++i )
+    {
+        m_trees.push_back( static_cast< Tree * >( * i ) );
+        m_entities.push_back( * i );
+    }
+    entities = Entity::databaseFactory( TYPE_PARKED );
+    for ( i = entities.begin(); i != entities.end(); ++i )
+    {
+        m_parked.push_back( static_cast< Parked * >( * i ) );
+        m_entities.push_back( * i );
+    }
+    entities = Entity::databaseFactory( TYPE_CAR );
+    for ( i = entities.begin(); i != entities.end(); ++i )
+    {
+        m_cars.push_back( static_cast< Car * >( * i ) );
+        m_entities.push_back( * i );
+    }
+    entities = Entity::databaseFactory( TYPE_GUY );
+    for ( i = entities.begin(); i != entities.end(); ++i )
+    {
+        m_guys.push_back( static_cast< Guy * >( * i ) );
+        m_entities.push_back( * i );
+        if ( m_guys.back()->getAllegiance() == ALLEGIANCE_ASSET )
+        {
+            m_squad.push_back( m_guys.back() );
+        }
+    }
+
+    for ( unsigned int j = 0; j < m_entities.size(); ++j )
+    {
+        m_entities[j]->setIndex( j );
+    }
+
+    _snapshot();
+    Engine::nav()->bake( Engine::b2d() );
+
+    m_loaded = true;
+}
+
+//------------------------------------------------------------------------------
+void
+WorldCache::restore()
+{
+    if ( ! m_loaded )
+    {
+        return;
+    }
+
+    b2Vec2 zero( 0.0f, 0.0f );
+
+    // Emptying the containers first gives their occupants back their shapes,
+    // so that everything is in the physics world before it's put back.
+    std::vector< Car * >::iterator i;
+    for ( i = m_cars.begin(); i != m_cars.end(); ++i )
+    {
+        ( * i )->resetDamageable();
+        ( * i )->emptyContainer();
+    }
+    std::vector< Guy * >::iterator j;
+    for ( j = m_guys.begin(); j != m_guys.end(); ++j )
+    {
+        ( * j )->resetDamageable();
+        ( * j )->setLast( 0 );
+    }
+    std::vector< Building * >::iterator k;
+    for ( k = m_buildings.begin(); k != m_buildings.end(); ++k )
+    {
+        MetaBuilding * meta( ( * k )->getMeta() );
+        if ( meta->getOwner() == * k )
+        {
+            meta->resetDamageable();
+            meta->emptyContainer();
+        }
+    }
+
+    for ( unsigned int i = 0; i < m_entities.size(); ++i )
+    {
+        const EntityState & state( m_states[i] );
+        if ( state.released )
+        {
+            continue;
+        }
+        Entity * entity( m_entities[i] );
+        b2Body * body( entity->getBody() );
+
+        entity->clearActions();
+        entity->setVisible( state.visible );
+        entity->setAllegiance( state.allegiance );
+
+        body->SetXForm( state.position, state.angle );
+        body->GetShapeList()->m_groupIndex = state.group;
+        if ( body->IsDynamic() )
+        {
+            body->SetLinearVelocity( zero );
+            body->SetAngularVelocity( 0.0f );
+            body->PutToSleep();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+WorldCache::flush()
+{
+    while ( m_cars.size() > 0 )
+    {
+        delete m_cars.back();
+        m_cars.pop_back();
+    }
+    while ( m_trees.size() > 0 )
+    {
+        delete m_trees.back();
+        m_trees.pop_back();
+    }
+    while ( m_guys.size() > 0 )
+    {
+        delete m_guys.back();
+        m_guys.pop_back();
+    }
+    while ( m_buildings.size() > 0 )
+    {
+        delete m_buildings.back();
+        m_buildings.pop_back();
+    }
+    while ( m_parked.size() > 0 )
+    {
+        delete m_parked.back();
+        m_parked.pop_back();
+    }
+
+    m_squad.clear();
+    m_entities.clear();
+    m_states.clear();
+    Engine::nav()->clear();
+
+    m_loaded = false;
+    m_stale = false;
+}
+
+//------------------------------------------------------------------------------
+// Deletes an entity for good, body and all. Its slot is left empty rather than
+// closed up, as the random streams, saved games, replays and the visibility
+// and influence maps all know entities by their index. It won't be back when
+// the world is restored, so the world has to be loaded again before the next
+// mission.
+void
+WorldCache::release( Entity * entity )
+{
+    int index( entity->getIndex() );
+    if ( index < 0 || index >= static_cast< int >( m_entities.size() ) ||
+         m_entities[index] != entity )
+    {
+        return;
+    }
+    m_entities[index] = 0;
+    m_states[index].released = true;
+
+    switch ( entity->getType() )
+    {
+        case TYPE_CAR:
+        {
+            m_cars.erase( std::remove( m_cars.begin(), m_cars.end(), entity ),
+                          m_cars.end() );
+            break;
+        }
+        case TYPE_TREE:
+        {
+            m_trees.erase( std::remove( m_trees.begin(), m_trees.end(),
+                                        entity ), m_trees.end() );
+            break;
+        }
+        case TYPE_GUY:
+        {
+            m_guys.erase( std::remove( m_guys.begin(), m_guys.end(), entity ),
+                          m_guys.end() );
+            m_squad.erase( std::remove( m_squad.begin(), m_squad.end(),
+                                        entity ), m_squad.end() );
+            break;
+        }
+        case TYPE_BUILDING:
+        {
+            m_buildings.erase( std::remove( m_buildings.begin(),
+                                            m_buildings.end(), entity ),
+                               m_buildings.end() );
+            break;
+        }
+        case TYPE_PARKED:
+        {
+            m_parked.erase( std::remove( m_parked.begin(), m_parked.end(),
+                                         entity ), m_parked.end() );
+            break;
+        }
+    }
+
+    m_stale = true;
+
+    delete entity;
+}
+
+//------------------------------------------------------------------------------
+std::vector< Car * > &
+WorldCache::getCars()
+{
+    return m_cars;
+}
+
+//------------------------------------------------------------------------------
+std::vector< Tree * > &
+WorldCache::getTrees()
+{
+    return m_trees;
+}
+
+//------------------------------------------------------------------------------
+std::vector< Guy * > &
+WorldCache::getGuys()
+{
+    return m_guys;
+}
+
+//------------------------------------------------------------------------------
+std::vector< Building * > &
+WorldCache::getBuildings()
+{
+    return m_buildings;
+}
+
+//------------------------------------------------------------------------------
+std::vector< Parked * > &
+WorldCache::getParked()
+{
+    return m_parked;
+}
+
+//------------------------------------------------------------------------------
+std::vector< Guy * > &
+WorldCache::getSquad()
+{
+    return m_squad;
+}
+
+//------------------------------------------------------------------------------
+// Indexed by Entity::getIndex(), with a null left behind by each entity that
+// has been released.
+std::vector< Entity * > &
+WorldCache::getEntities()
+{
+    return m_entities;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+void
+WorldCache::_snapshot()
+{
+    m_states.clear();
+    m_states.reserve( m_entities.size() );
+
+    std::vector< Entity * >::iterator i;
+    for ( i = m_entities.begin(); i != m_entities.end(); ++i )
+    {
+        b2Body * body( ( * i )->getBody() );
+        EntityState state;
+        state.position = body->GetPosition();
+        state.angle = body->GetAngle();
+        state.group = body->GetShapeList()->m_groupIndex;
+        state.visible = ( * i )->getVisible();
+        state.allegiance = ( * i )->getAllegiance();
+        state.released = false;
+        m_states.push_back( state );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Each block of buildings becomes a single static body, which is all that the
+// game needs; the editor loads the buildings for itself and leaves them be.
+void
+WorldCache::_fuseBuildings()
+{
+    b2World * b2d( Engine::b2d() );
+    int before( b2d->GetProxyCount() );
+
+    std::map< MetaBuilding *, std::vector< Building * > > blocks;
+    std::vector< Building * >::iterator i;
+    for ( i = m_buildings.begin(); i != m_buildings.end(); ++i )
+    {
+        blocks[( * i )->getMeta()].push_back( * i );
+    }
+
+    // Fused in the order that the buildings were loaded, so that bodies are
+    // always created in the same order.
+    for ( i = m_buildings.begin(); i != m_buildings.end(); ++i )
+    {
+        MetaBuilding * meta( ( * i )->getMeta() );
+        if ( meta->getOwner() == * i )
+        {
+            meta->fuse( blocks[meta] );
+        }
+    }
+
+    Engine::hge()->System_Log( "Fused %d buildings into %d bodies, "
+                               "%d proxies before and %d after",
+                               m_buildings.size(), blocks.size(),
+                               before, b2d->GetProxyCount() );
+}
+
+//==============================================================================
@@ -0,0 +1,70 @@
+//==============================================================================
+
+#ifndef ArseCache
+#define ArseCache
+
+#include <vector>
+
+#include <Box2D.h>
+
+#include <entity.hpp>
+
+//------------------------------------------------------------------------------
+// Holds the mission world between visits to the game context. The world is
+// loaded from the database once, snapshotted, and then restored in memory on
+// every subsequent mission start instead of being torn down and reloaded.
+class WorldCache
+{
+  public:
+    WorldCache();
+    ~WorldCache();
+
+  private:
+    WorldCache( const WorldCache & );
+    WorldCache & operator=( const WorldCache & );
+
+    struct EntityState
+    {
+        b2Vec2 position;
+        float angle;
+        int group;
+        bool visible;
+        EntityAllegiance allegiance;
+        bool released;
+    };
+
+  public:
+    bool isLoaded();
+    void load();
+    void restore();
+    void flush();
+    void release( Entity * entity );
+
+    std::vector< Car * > & getCars();
+    std::vector< Tree * > & getTrees();
+    std::vector< Guy * > & getGuys();
+    std::vector< Building * > & getBuildings();
+    std::vector< Parked * > & getParked();
+    std::vector< Guy * > & getSquad();
+    std::vector< Entity * > & getEntities();
+
+  private:
+    void _snapshot();
+    void _fuseBuildings();
+
+  private:
+    bool m_loaded;
+    bool m_stale;
+    std::vector< Car * > m_cars;
+    std::vector< Tree * > m_trees;
+    std::vector< Guy * > m_guys;
+    std::vector< Building * > m_buildings;
+    std::vector< Parked * > m_parked;
+    std::vector< Guy * > m_squad;
+    std::vector< Entity * > m_entities;
+    std::vector< EntityState > m_states;
+};
+
+#endif
+
+//==============================================================================
@@ -1,15 +1,15 @@
-//==============================================================================
-
-#include <context.hpp>
-
-//------------------------------------------------------------------------------
-Context::Context()
-{
-}
-
-//------------------------------------------------------------------------------
-Context::~Context()
-{
-}
-
-//==============================================================================
+//==============================================================================
+
+#include <context.hpp>
+
+//------------------------------------------------------------------------------
+Context::Context()
+{
+}
+
+//------------------------------------------------------------------------------
+Context::~Context()
+{
+}
+
+//==============================================================================
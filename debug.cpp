@@ -1,140 +1,257 @@
-//==============================================================================
-
-#include <hge.h>
-#include <viewport.hpp>
-#include <debug.hpp>
-
-//------------------------------------------------------------------------------
-DebugDraw::DebugDraw( HGE * hge, ViewPort * viewport )
-    :
-    m_hge( hge ),
-    m_viewport( viewport )
-{
-}
-
-//------------------------------------------------------------------------------
-DebugDraw::~DebugDraw()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-DebugDraw::DrawPolygon( const b2Vec2 * vertices, int32 vertexCount,
-                        const b2Color & color )
-{
-    for ( int32 i = 0; i < vertexCount - 1; ++i )
-    {
-        DrawSegment( vertices[i], vertices[i + 1], color );
-    }
-    DrawSegment( vertices[vertexCount - 1], vertices[0], color );
-}
- 
-//------------------------------------------------------------------------------
-void
-DebugDraw::DrawSolidPolygon( const b2Vec2 * vertices, int32 vertexCount,
-                             const b2Color & color )
-{
-    b2Vec2 average( 0.0f, 0.0f );
-    for ( int i = 0; i < vertexCount; ++ i )
-    {
-        average.x += vertices[i].x;
-        average.y += vertices[i].y;
-    }
-    average.x /= static_cast< float >( vertexCount );
-    average.y /= static_cast< float >( vertexCount );
-    for ( int i = 0; i < vertexCount; ++ i )
-    {
-        int j = i + 1;
-        if ( j >= vertexCount )
-        {
-            j = 0;
-        }
-        hgeTriple triple;
-        _setVertex( triple.v[0], vertices[i], color );
-        _setVertex( triple.v[1], average, color );
-        _setVertex( triple.v[2], vertices[j], color );
-        triple.tex = 0;
-        triple.blend = BLEND_ALPHABLEND;
-        m_hge->Gfx_RenderTriple( & triple );
-    }
-}
- 
-//------------------------------------------------------------------------------
-void
-DebugDraw::DrawCircle( const b2Vec2 & center, float32 radius,
-                       const b2Color & color ) 
-{
-    b2Vec2 vertices[16];
-    _getCircleVertices( vertices, center, radius );
-    DrawPolygon( vertices, 16, color );
-}
- 
-//------------------------------------------------------------------------------
-void
-DebugDraw::DrawSolidCircle( const b2Vec2 & center, float32 radius,
-                            const b2Vec2 & axis, const b2Color & color ) 
-{
-    b2Vec2 vertices[16];
-    _getCircleVertices( vertices, center, radius );
-    DrawSolidPolygon( vertices, 16, color );
-}
- 
-//------------------------------------------------------------------------------
-void
-DebugDraw::DrawSegment( const b2Vec2 & p1, const b2Vec2 & p2,
-                        const b2Color & color ) 
-{
-    m_hge->Gfx_RenderLine( p1.x, p1.y, p2.x, p2.y, _hgeColor( color ) );
-}
- 
-//------------------------------------------------------------------------------
-void
-DebugDraw::DrawXForm( const b2XForm & xf ) 
-{
-}
-
-//------------------------------------------------------------------------------
-// private:
-//------------------------------------------------------------------------------
-DWORD
-DebugDraw::_hgeColor( b2Color color )
-{
-    return ARGB( 0x88,
-                 static_cast<int>( 0xFF * color.r ),
-                 static_cast<int>( 0xFF * color.g ),
-                 static_cast<int>( 0xFF * color.b ) );
-}
-
-//------------------------------------------------------------------------------
-void
-DebugDraw::_setVertex( hgeVertex & vertex, const b2Vec2 & vector,
-                       const b2Color & color )
-{
-    vertex.x = vector.x;
-    vertex.y = vector.y;
-    vertex.z = 0;
-    vertex.col = _hgeColor( color );
-    vertex.tx = 0;
-    vertex.ty = 0;
-}
-
-//------------------------------------------------------------------------------
-void
-DebugDraw::_getCircleVertices( b2Vec2 ( & vertices )[16], const b2Vec2 & center,
-                               float radius )
-{
-    float angle( 0.0f );
-    float step( 2.0f * M_PI / 15.0f );
-    vertices[0].x = 0.0f;
-    vertices[0].y = radius;
-    b2Mat22 rotation;
-    for ( int i = 1; i < 16; ++i )
-    {
-        angle += step;
-        rotation.Set( angle );
-        vertices[i] = b2Mul( rotation, vertices[0] ) + center;
-    }
-    vertices[0] += center;
-}
-
-//==============================================================================
+//==============================================================================
+
+#include <hge.h>
+#include <viewport.hpp>
+#include <debug.hpp>
+
+//------------------------------------------------------------------------------
+
+b2Vec2 DebugDraw::s_circle[16];
+bool DebugDraw::s_circleReady( false );
+
+//------------------------------------------------------------------------------
+DebugDraw::DebugDraw( HGE * hge, ViewPort * viewport )
+    :
+    m_hge( hge ),
+    m_viewport( viewport ),
+    m_lines(),
+    m_triangles(),
+    m_view(),
+    m_culling( false )
+{
+    if ( ! s_circleReady )
+    {
+        for ( int i = 0; i < 16; ++i )
+        {
+            float angle( 2.0f * M_PI * static_cast< float >( i ) / 16.0f );
+            s_circle[i].Set( -sinf( angle ), cosf( angle ) );
+        }
+        s_circleReady = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+DebugDraw::~DebugDraw()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+DebugDraw::DrawPolygon( const b2Vec2 * vertices, int32 vertexCount,
+                        const b2Color & color )
+{
+    if ( ! _isVisible( vertices, vertexCount ) )
+    {
+        return;
+    }
+    DWORD colour( _hgeColor( color ) );
+    hgeVertex vertex;
+    for ( int32 i = 0; i < vertexCount; ++i )
+    {
+        int32 j( i + 1 < vertexCount ? i + 1 : 0 );
+        _setVertex( vertex, vertices[i], colour );
+        m_lines.push_back( vertex );
+        _setVertex( vertex, vertices[j], colour );
+        m_lines.push_back( vertex );
+    }
+}
+ 
+//------------------------------------------------------------------------------
+void
+DebugDraw::DrawSolidPolygon( const b2Vec2 * vertices, int32 vertexCount,
+                             const b2Color & color )
+{
+    if ( ! _isVisible( vertices, vertexCount ) )
+    {
+        return;
+    }
+    b2Vec2 average( 0.0f, 0.0f );
+    for ( int i = 0; i < vertexCount; ++ i )
+    {
+        average.x += vertices[i].x;
+        average.y += vertices[i].y;
+    }
+    average.x /= static_cast< float >( vertexCount );
+    average.y /= static_cast< float >( vertexCount );
+    DWORD colour( _hgeColor( color ) );
+    hgeVertex vertex;
+    for ( int i = 0; i < vertexCount; ++ i )
+    {
+        int j = i + 1;
+        if ( j >= vertexCount )
+        {
+            j = 0;
+        }
+        _setVertex( vertex, vertices[i], colour );
+        m_triangles.push_back( vertex );
+        _setVertex( vertex, average, colour );
+        m_triangles.push_back( vertex );
+        _setVertex( vertex, vertices[j], colour );
+        m_triangles.push_back( vertex );
+    }
+}
+ 
+//------------------------------------------------------------------------------
+void
+DebugDraw::DrawCircle( const b2Vec2 & center, float32 radius,
+                       const b2Color & color ) 
+{
+    if ( ! _isVisible( center, radius ) )
+    {
+        return;
+    }
+    b2Vec2 vertices[16];
+    _getCircleVertices( vertices, center, radius );
+    DrawPolygon( vertices, 16, color );
+}
+ 
+//------------------------------------------------------------------------------
+void
+DebugDraw::DrawSolidCircle( const b2Vec2 & center, float32 radius,
+                            const b2Vec2 & axis, const b2Color & color ) 
+{
+    if ( ! _isVisible( center, radius ) )
+    {
+        return;
+    }
+    b2Vec2 vertices[16];
+    _getCircleVertices( vertices, center, radius );
+    DrawSolidPolygon( vertices, 16, color );
+}
+ 
+//------------------------------------------------------------------------------
+void
+DebugDraw::DrawSegment( const b2Vec2 & p1, const b2Vec2 & p2,
+                        const b2Color & color ) 
+{
+    b2Vec2 ends[2] = { p1, p2 };
+    if ( ! _isVisible( ends, 2 ) )
+    {
+        return;
+    }
+    DWORD colour( _hgeColor( color ) );
+    hgeVertex vertex;
+    _setVertex( vertex, p1, colour );
+    m_lines.push_back( vertex );
+    _setVertex( vertex, p2, colour );
+    m_lines.push_back( vertex );
+}
+ 
+//------------------------------------------------------------------------------
+void
+DebugDraw::DrawXForm( const b2XForm & xf ) 
+{
+}
+
+//------------------------------------------------------------------------------
+// Sends everything drawn since the last flush, and works out afresh what's on
+// screen for whatever gets drawn next.
+void
+DebugDraw::flush()
+{
+    _flush( m_triangles, HGEPRIM_TRIPLES, 3 );
+    _flush( m_lines, HGEPRIM_LINES, 2 );
+    m_culling = false;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+DWORD
+DebugDraw::_hgeColor( b2Color color )
+{
+    return ARGB( 0x88,
+                 static_cast<int>( 0xFF * color.r ),
+                 static_cast<int>( 0xFF * color.g ),
+                 static_cast<int>( 0xFF * color.b ) );
+}
+
+//------------------------------------------------------------------------------
+void
+DebugDraw::_setVertex( hgeVertex & vertex, const b2Vec2 & vector,
+                       DWORD color )
+{
+    vertex.x = vector.x;
+    vertex.y = vector.y;
+    vertex.z = 0;
+    vertex.col = color;
+    vertex.tx = 0;
+    vertex.ty = 0;
+}
+
+//------------------------------------------------------------------------------
+bool
+DebugDraw::_isVisible( const b2Vec2 * vertices, int32 vertexCount )
+{
+    if ( m_viewport == 0 || vertexCount == 0 )
+    {
+        return true;
+    }
+    if ( ! m_culling )
+    {
+        m_viewport->getView( m_view );
+        m_culling = true;
+    }
+    b2Vec2 lower( vertices[0] );
+    b2Vec2 upper( vertices[0] );
+    for ( int32 i = 1; i < vertexCount; ++i )
+    {
+        lower = b2Min( lower, vertices[i] );
+        upper = b2Max( upper, vertices[i] );
+    }
+    return upper.x >= m_view.lowerBound.x && lower.x <= m_view.upperBound.x &&
+           upper.y >= m_view.lowerBound.y && lower.y <= m_view.upperBound.y;
+}
+
+//------------------------------------------------------------------------------
+bool
+DebugDraw::_isVisible( const b2Vec2 & center, float radius )
+{
+    b2Vec2 extent( radius, radius );
+    b2Vec2 corners[2] = { center - extent, center + extent };
+    return _isVisible( corners, 2 );
+}
+
+//------------------------------------------------------------------------------
+// Copies the buffer into as many batches as it takes, untextured and blended
+// the same way as before.
+void
+DebugDraw::_flush( std::vector< hgeVertex > & vertices, int type, int size )
+{
+    unsigned int next( 0 );
+    while ( next < vertices.size() )
+    {
+        int max( 0 );
+        hgeVertex * batch( m_hge->Gfx_StartBatch( type, 0, BLEND_ALPHABLEND,
+                                                  & max ) );
+        if ( batch == 0 || max <= 0 )
+        {
+            break;
+        }
+        unsigned int count( ( vertices.size() - next ) / size );
+        if ( count > static_cast< unsigned int >( max ) )
+        {
+            count = max;
+        }
+        for ( unsigned int i = 0; i < count * size; ++i )
+        {
+            batch[i] = vertices[next + i];
+        }
+        m_hge->Gfx_FinishBatch( count );
+        next += count * size;
+    }
+    vertices.clear();
+}
+
+//------------------------------------------------------------------------------
+void
+DebugDraw::_getCircleVertices( b2Vec2 ( & vertices )[16], const b2Vec2 & center,
+                               float radius )
+{
+    for ( int i = 0; i < 16; ++i )
+    {
+        vertices[i] = radius * s_circle[i] + center;
+    }
+}
+
+//==============================================================================
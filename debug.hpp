@@ -1,43 +1,60 @@
-//==============================================================================
-
-#ifndef ArseDebug
-#define ArseDebug
-
-#include <Box2D.h>
-
-class HGE;
-class ViewPort;
-struct hgeVertex;
-
-//------------------------------------------------------------------------------
-class DebugDraw: public b2DebugDraw
-{
-  public:
-    DebugDraw( HGE * hge = 0, ViewPort * viewport = 0 );
-    ~DebugDraw();
-    virtual void DrawPolygon( const b2Vec2 * vertices, int32 vertexCount,
-                              const b2Color & color );
-    virtual void  DrawSolidPolygon( const b2Vec2 * vertices, int32 vertexCount,
-                                    const b2Color & color );
-    virtual void  DrawCircle( const b2Vec2 & center, float32 radius,
-                              const b2Color & color );
-    virtual void  DrawSolidCircle( const b2Vec2 & center, float32 radius,
-                                   const b2Vec2 & axis, const b2Color & color );
-    virtual void  DrawSegment( const b2Vec2 & p1, const b2Vec2 & p2,
-                               const b2Color & color );
-    virtual void  DrawXForm( const b2XForm & xf );
-
-  private:
-    DWORD _hgeColor( b2Color color );
-    void _setVertex( hgeVertex & vertex, const b2Vec2 & vector,
-                     const b2Color & color );
-
-    void _getCircleVertices( b2Vec2 ( & vertices )[16], const b2Vec2 & center,
-                             float radius );
-    HGE * m_hge;
-    ViewPort * m_viewport;
-};
-
-#endif
-
-//==============================================================================
+//==============================================================================
+
+#ifndef ArseDebug
+#define ArseDebug
+
+#include <vector>
+
+#include <Box2D.h>
+
+class HGE;
+class ViewPort;
+struct hgeVertex;
+
+//------------------------------------------------------------------------------
+// Box2D's debug drawing, collected into a buffer of lines and a buffer of
+// triangles that go out as a couple of batches when flushed, rather than one
+// draw for every edge. Circles come from a table worked out once, and shapes
+// that are nowhere near the screen are dropped as they arrive.
+class DebugDraw: public b2DebugDraw
+{
+  public:
+    DebugDraw( HGE * hge = 0, ViewPort * viewport = 0 );
+    ~DebugDraw();
+    virtual void DrawPolygon( const b2Vec2 * vertices, int32 vertexCount,
+                              const b2Color & color );
+    virtual void  DrawSolidPolygon( const b2Vec2 * vertices, int32 vertexCount,
+                                    const b2Color & color );
+    virtual void  DrawCircle( const b2Vec2 & center, float32 radius,
+                              const b2Color & color );
+    virtual void  DrawSolidCircle( const b2Vec2 & center, float32 radius,
+                                   const b2Vec2 & axis, const b2Color & color );
+    virtual void  DrawSegment( const b2Vec2 & p1, const b2Vec2 & p2,
+                               const b2Color & color );
+    virtual void  DrawXForm( const b2XForm & xf );
+
+    void flush();
+
+  private:
+    DWORD _hgeColor( b2Color color );
+    void _setVertex( hgeVertex & vertex, const b2Vec2 & vector, DWORD color );
+    bool _isVisible( const b2Vec2 * vertices, int32 vertexCount );
+    bool _isVisible( const b2Vec2 & center, float radius );
+    void _flush( std::vector< hgeVertex > & vertices, int type, int size );
+
+    void _getCircleVertices( b2Vec2 ( & vertices )[16], const b2Vec2 & center,
+                             float radius );
+    HGE * m_hge;
+    ViewPort * m_viewport;
+    std::vector< hgeVertex > m_lines;
+    std::vector< hgeVertex > m_triangles;
+    b2AABB m_view;
+    bool m_culling;
+
+    static b2Vec2 s_circle[16];
+    static bool s_circleReady;
+};
+
+#endif
+
+//==============================================================================
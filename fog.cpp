@@ -0,0 +1,158 @@
+//==============================================================================
+
+#include <hge.h>
+
+#include <fog.hpp>
+#include <engine.hpp>
+#include <visibility.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const float WORLD_MIN( -2500.0f );
+    const int TEXTURE_SIZE( 256 );
+    const DWORD FOG_UNKNOWN( 0xEE000000 );
+    const DWORD FOG_EXPLORED( 0x88000000 );
+    const DWORD FOG_CLEAR( 0x00000000 );
+};
+
+//------------------------------------------------------------------------------
+Fog::Fog()
+    :
+    m_visibility( 0 ),
+    m_texture( 0 ),
+    m_quad(),
+    m_explored()
+{
+}
+
+//------------------------------------------------------------------------------
+Fog::~Fog()
+{
+    fini();
+}
+
+//------------------------------------------------------------------------------
+void
+Fog::init( Visibility * visibility )
+{
+    HGE * hge( Engine::hge() );
+
+    fini();
+
+    m_visibility = visibility;
+    int width( m_visibility->getWidth() );
+    int height( m_visibility->getHeight() );
+    m_explored.assign( width * height, 0 );
+
+    m_texture = hge->Texture_Create( TEXTURE_SIZE, TEXTURE_SIZE );
+    if ( m_texture == 0 )
+    {
+        hge->System_Log( "Couldn't create the fog of war texture!" );
+        return;
+    }
+    int pitch( hge->Texture_GetWidth( m_texture ) );
+    int rows( hge->Texture_GetHeight( m_texture ) );
+    DWORD * texels( hge->Texture_Lock( m_texture, false ) );
+    if ( texels != 0 )
+    {
+        for ( int i = 0; i < pitch * rows; ++i )
+        {
+            texels[i] = FOG_UNKNOWN;
+        }
+        hge->Texture_Unlock( m_texture );
+    }
+
+    // The grid only fills part of the texture, so the quad covers the world
+    // and stops short of the texture's far edges.
+    float extent( width * m_visibility->getCellSize() );
+    float u( static_cast< float >( width ) / static_cast< float >( pitch ) );
+    float v( static_cast< float >( height ) / static_cast< float >( rows ) );
+    for ( int i = 0; i < 4; ++i )
+    {
+        m_quad.v[i].x = WORLD_MIN + ( i == 1 || i == 2 ? extent : 0.0f );
+        m_quad.v[i].y = WORLD_MIN + ( i >= 2 ? extent : 0.0f );
+        m_quad.v[i].z = 0.5f;
+        m_quad.v[i].col = 0xFFFFFFFF;
+        m_quad.v[i].tx = i == 1 || i == 2 ? u : 0.0f;
+        m_quad.v[i].ty = i >= 2 ? v : 0.0f;
+    }
+    m_quad.tex = m_texture;
+    m_quad.blend = BLEND_DEFAULT;
+}
+
+//------------------------------------------------------------------------------
+void
+Fog::fini()
+{
+    if ( m_texture != 0 )
+    {
+        Engine::hge()->Texture_Free( m_texture );
+        m_texture = 0;
+    }
+    m_visibility = 0;
+    m_explored.clear();
+}
+
+//------------------------------------------------------------------------------
+void
+Fog::update()
+{
+    if ( m_texture == 0 )
+    {
+        return;
+    }
+
+    int left( 0 );
+    int top( 0 );
+    int right( 0 );
+    int bottom( 0 );
+    if ( ! m_visibility->getDirty( left, top, right, bottom ) )
+    {
+        return;
+    }
+
+    HGE * hge( Engine::hge() );
+    int width( m_visibility->getWidth() );
+    int pitch( hge->Texture_GetWidth( m_texture ) );
+    DWORD * texels( hge->Texture_Lock( m_texture, false, left, top,
+                                       right - left + 1,
+                                       bottom - top + 1 ) );
+    if ( texels == 0 )
+    {
+        return;
+    }
+    for ( int y = top; y <= bottom; ++y )
+    {
+        DWORD * row( texels + ( y - top ) * pitch - left );
+        for ( int x = left; x <= right; ++x )
+        {
+            int cell( y * width + x );
+            if ( m_visibility->isSeen( cell ) )
+            {
+                m_explored[cell] = 1;
+                row[x] = FOG_CLEAR;
+            }
+            else
+            {
+                row[x] = m_explored[cell] != 0 ? FOG_EXPLORED : FOG_UNKNOWN;
+            }
+        }
+    }
+    hge->Texture_Unlock( m_texture );
+
+    m_visibility->clean();
+}
+
+//------------------------------------------------------------------------------
+void
+Fog::render()
+{
+    if ( m_texture != 0 )
+    {
+        Engine::hge()->Gfx_RenderQuad( & m_quad );
+    }
+}
+
+//==============================================================================
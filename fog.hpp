@@ -0,0 +1,43 @@
+//==============================================================================
+
+#ifndef ArseFog
+#define ArseFog
+
+#include <vector>
+
+#include <hge.h>
+
+class Visibility;
+
+//------------------------------------------------------------------------------
+// The fog of war, kept as a texture with one texel for each cell of the
+// visibility grid and stretched over the whole map as a single quad. Places
+// the squad has never been stay dark, places they've been but can't see any
+// more are dimmed, and only the texels within the rectangle that visibility
+// reports as changed are written each frame.
+class Fog
+{
+  public:
+    Fog();
+    ~Fog();
+
+  private:
+    Fog( const Fog & );
+    Fog & operator=( const Fog & );
+
+  public:
+    void init( Visibility * visibility );
+    void fini();
+    void update();
+    void render();
+
+  private:
+    Visibility * m_visibility;
+    HTEXTURE m_texture;
+    hgeQuad m_quad;
+    std::vector< unsigned char > m_explored;
+};
+
+#endif
+
+//==============================================================================
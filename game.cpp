@@ -1,974 +1,1574 @@
-//==============================================================================
-
-#include <algorithm>
-
-#include <hgeresource.h>
-#include <hgesprite.h>
-#include <hgefont.h>
-
-#include <game.hpp>
-#include <engine.hpp>
-#include <entity.hpp>
-#include <viewport.hpp>
-#include <score.hpp>
-
-//------------------------------------------------------------------------------
-
-namespace
-{
-    const char * ACTION_NAME[] =
-    {
-        "",
-        "Move",
-        "Halt",
-        "Identify",
-        "Detain",
-        "Attack",
-        "Shock"
-    };
-};
-
-//------------------------------------------------------------------------------
-Mouse::MouseButton::MouseButton()
-    :
-    m_state( MOUSE_START ),
-    m_action( ACTION_NONE ),
-    m_timer(),
-    m_last( 0.0f, 0.0f ),
-    m_delta( 0.0f, 0.0f ),
-    m_total( 0.0f, 0.0f )
-{
-}
-
-//------------------------------------------------------------------------------
-Mouse::MouseButton::~MouseButton()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-Mouse::MouseButton::clear()
-{
-    m_state = MOUSE_START;
-    m_action = ACTION_NONE;
-    m_timer = 0.0f;
-    Engine::hge()->Input_GetMousePos( & m_last.x, & m_last.y );
-    m_delta.SetZero();
-    m_total.SetZero();
-}
-
-//------------------------------------------------------------------------------
-void
-Mouse::MouseButton::update( float dt, bool state )
-{
-    m_timer += dt;
-
-    b2Vec2 position( 0.0f, 0.0f );
-    Engine::hge()->Input_GetMousePos( & position.x, & position.y );
-    m_delta = position - m_last;
-    m_total += m_delta;
-    m_last = position;
-
-    float offset( m_total.LengthSquared() );
-
-    switch ( m_state )
-    {
-        case MOUSE_START:
-        {
-            if ( state )
-            {
-                m_timer = 0.0f;
-                m_state = MOUSE_FIRST_DOWN;
-                m_total.SetZero();
-            }
-            {
-                m_action = ACTION_NONE;
-            }
-            break;
-        }
-        case MOUSE_FIRST_DOWN:
-        {
-            if ( ! state )
-            {
-                m_timer = 0.0f;
-                m_state = MOUSE_FIRST_UP;
-                m_total.SetZero();
-            }
-            else if ( m_timer > 0.2f || offset > 9.0f )
-            {
-                m_action = ACTION_DRAGGING;
-                m_state = MOUSE_END;
-            }
-            break;
-        }
-        case MOUSE_FIRST_UP:
-        {
-            if ( state )
-            {
-                m_timer = 0.0f;
-                m_state = MOUSE_SECOND_DOWN;
-                m_total.SetZero();
-            }
-            else if ( m_timer > 0.1f || offset > 1.0f )
-            {
-                m_action = ACTION_CLICKED;
-                m_state = MOUSE_START;
-            }
-            break;
-        }
-        case MOUSE_SECOND_DOWN:
-        {
-            if ( ! state )
-            {
-                m_timer = 0.0f;
-                m_state = MOUSE_SECOND_UP;
-                m_total.SetZero();
-            }
-            if ( m_timer > 0.2f || offset > 9.0f )
-            {
-                m_action = ACTION_DRAGGING;
-                m_state = MOUSE_END;
-            }
-            break;
-        }
-        case MOUSE_SECOND_UP:
-        {
-            m_action = ACTION_DOUBLED;
-            m_state = MOUSE_START;
-            break;
-        }
-        case MOUSE_END:
-        {
-            if ( ! state )
-            {
-                m_action = ACTION_NONE;
-                m_state = MOUSE_START;
-            }
-            break;
-        }
-    }
-}
-
-//------------------------------------------------------------------------------
-bool
-Mouse::MouseButton::dragging() const
-{
-    return m_action == ACTION_DRAGGING;
-}
-
-//------------------------------------------------------------------------------
-bool
-Mouse::MouseButton::clicked() const
-{
-    return m_action == ACTION_CLICKED;
-}
-
-//------------------------------------------------------------------------------
-bool
-Mouse::MouseButton::doubleClicked() const
-{
-    return m_action == ACTION_DOUBLED;
-}
-
-//------------------------------------------------------------------------------
-const b2Vec2 &
-Mouse::MouseButton::getDelta() const
-{
-    return m_delta;
-}
-
-//==============================================================================
-Mouse::Mouse()
-    :
-    m_left(),
-    m_right()
-{
-}
-
-//------------------------------------------------------------------------------
-Mouse::~Mouse()
-{
-}
-
-//------------------------------------------------------------------------------
-void
-Mouse::clear()
-{
-    m_left.clear();
-    m_right.clear();
-}
-
-//------------------------------------------------------------------------------
-void
-Mouse::update( float dt )
-{
-    m_left.update( dt, Engine::hge()->Input_GetKeyState( HGEK_LBUTTON ) ); 
-    m_right.update( dt, Engine::hge()->Input_GetKeyState( HGEK_RBUTTON ) ); 
-}
-
-//------------------------------------------------------------------------------
-const Mouse::MouseButton &
-Mouse::getLeft()
-{
-    return m_left;
-}
-
-//------------------------------------------------------------------------------
-const Mouse::MouseButton &
-Mouse::getRight()
-{
-    return m_right;
-}
-
-//==============================================================================
-Game::Game()
-    :
-    Context(),
-    m_gui( 0 ),
-    m_zoom( 2 ),
-    m_cars(),
-    m_trees(),
-    m_guys(),
-    m_buildings(),
-    m_parked(),
-    m_picked( 0 ),
-    m_team(),
-    m_squad(),
-    m_actionType( TYPE_MOVE ),
-    m_lock_camera( false ),
-    m_locked( 0 ),
-    m_mouse()
-{
-}
-
-//------------------------------------------------------------------------------
-Game::~Game()
-{
-}
-
-//------------------------------------------------------------------------------
-// public:
-//------------------------------------------------------------------------------
-void
-Game::init()
-{
-    HGE * hge( Engine::hge() );
-    b2World * b2d( Engine::b2d() );
-    hgeResourceManager * rm( Engine::rm() );
-    ViewPort * vp( Engine::vp() );
-
-    vp->offset().x = 1742.0f;
-    vp->offset().y = 2349.0f;
-    vp->bounds().x = 800.0f;
-    vp->bounds().y = 600.0f;
-
-    Entity::resetNextGroupIndex();
-
-    m_zoom = 3;
-    m_picked = 0;
-    m_actionType = TYPE_MOVE;
-    m_lock_camera = false;
-    m_locked = 0;
-
-    m_gui = new hgeSprite( 0, 0, 0, 1, 1 );
-
-    std::vector< Entity * > entities;
-    std::vector< Entity * >::iterator i;
-
-    entities = Entity::databaseFactory( TYPE_BUILDING );
-    for ( i = entities.begin(); i != entities.end(); ++i )
-    {
-        m_buildings.push_back( static_cast< Building * >( * i ) );
-    }
-    entities = Entity::databaseFactory( TYPE_TREE );
-    for ( i = entities.begin(); i != entities.end(); ++i )
-    {
-        m_trees.push_back( static_cast< Tree * >( * i ) );
-    }
-    entities = Entity::databaseFactory( TYPE_PARKED );
-    for ( i = entities.begin(); i != entities.end(); ++i )
-    {
-        m_parked.push_back( static_cast< Parked * >( * i ) );
-    }
-    entities = Entity::databaseFactory( TYPE_CAR );
-    for ( i = entities.begin(); i != entities.end(); ++i )
-    {
-        m_cars.push_back( static_cast< Car * >( * i ) );
-    }
-    entities = Entity::databaseFactory( TYPE_GUY );
-    for ( i = entities.begin(); i != entities.end(); ++i )
-    {
-        m_guys.push_back( static_cast< Guy * >( * i ) );
-        if ( m_guys.back()->getAllegiance() == ALLEGIANCE_ASSET )
-        {
-            m_squad.push_back( m_guys.back() );
-        }
-    }
-
-    m_team.push_back( m_squad.front() );
-
-    b2Vec2 offset( 100.0f, 100.0f );
-    b2Vec2 position( m_team.back()->getBody()->GetPosition() );
-    b2Shape * shapes[99];
-    b2AABB aabb;
-    aabb.lowerBound = position - offset;
-    aabb.upperBound = position + offset;
-    int num( Engine::b2d()->Query( aabb, shapes, 99 ) );
-    for ( int i = 0; i < num; ++i )
-    {
-        Entity * entity =
-            static_cast< Entity * >( shapes[0]->GetBody()->GetUserData() );
-        if ( entity->getType() == TYPE_BUILDING )
-        {
-            m_picked = entity;
-            break;
-        }
-    }
-    _setViewport( m_picked );
-
-    m_mouse.clear();
-
-    HMUSIC music = Engine::rm()->GetMusic( "game" );
-    Engine::hge()->Music_Play( music, true, 50, 0, 0 );
-}
-
-//------------------------------------------------------------------------------
-void
-Game::fini()
-{
-    while ( m_cars.size() > 0 )
-    {
-        delete m_cars.back();
-        m_cars.pop_back();
-    }
-    while ( m_trees.size() > 0 )
-    {
-        delete m_trees.back();
-        m_trees.pop_back();
-    }
-    while ( m_guys.size() > 0 )
-    {
-        delete m_guys.back();
-        m_guys.pop_back();
-    }
-    while ( m_buildings.size() > 0 )
-    {
-        delete m_buildings.back();
-        m_buildings.pop_back();
-    }
-    while ( m_parked.size() > 0 )
-    {
-        delete m_parked.back();
-        m_parked.pop_back();
-    }
-
-    m_team.clear();
-    m_squad.clear();
-
-    Engine::hge()->Channel_StopAll();
-    delete m_gui;
-    m_gui = 0;
-}
-
-//------------------------------------------------------------------------------
-bool
-Game::update( float dt )
-{
-    HGE * hge( Engine::hge() );
-    b2World * b2d( Engine::b2d() );
-    ViewPort * vp( Engine::vp() );
-
-    if ( hge->Input_GetKeyState( HGEK_ESCAPE ) &&
-         Engine::instance()->isPaused() )
-    {
-        Engine::instance()->switchContext( STATE_MENU );
-        return false;
-    }
-
-        /*
-        Engine::instance()->switchContext( STATE_SCORE );
-        Score * score( static_cast< Score * >(
-            Engine::instance()->getContext() ) );
-        score->calculateScore( 0, 0, 0, 0 );
-        return false;
-        */
-
-    _updateCars( dt );
-    _updateGuys( dt );
-    _updateBuildings( dt );
-
-    m_mouse.update( dt );
-
-    if ( m_mouse.getLeft().doubleClicked() )
-    {
-        m_zoom += 1;
-        if ( m_zoom > 3 )
-        {
-            m_zoom = 3;
-        }
-        else
-        {
-            b2Vec2 point( 0.0f, 0.0f );
-            hge->Input_GetMousePos( & point.x, & point.y );
-            vp->offset().x += ( 400.0f - point.x ) / vp->hscale();
-            vp->offset().y += ( 300.0f - point.y ) / vp->hscale();
-            hge->Input_SetMousePos( 400.0f, 300.0f );
-        }
-    }
-    if ( m_mouse.getRight().doubleClicked() )
-    {
-        m_zoom -= 1;
-        if ( m_zoom < 1 )
-        {
-            m_zoom = 1;
-        }
-        else
-        {
-            b2Vec2 point( 0.0f, 0.0f );
-            hge->Input_GetMousePos( & point.x, & point.y );
-            vp->offset().x += ( 400.0f - point.x ) / vp->hscale();
-            vp->offset().y += ( 300.0f - point.y ) / vp->hscale();
-            hge->Input_SetMousePos( 400.0f, 300.0f );
-        }
-    }
-    switch ( m_zoom )
-    {
-        case 1:
-        {
-            vp->bounds().x = 1600.0f;
-            vp->bounds().y = 1200.0f;
-            break;
-        }
-        case 2:
-        {
-            vp->bounds().x = 800.0f;
-            vp->bounds().y = 600.0f;
-            break;
-        }
-        case 3:
-        {
-            vp->bounds().x = 400.0f;
-            vp->bounds().y = 300.0f;
-            break;
-        }
-    }
-    int actionDelta( hge->Input_GetMouseWheel() );
-    if ( hge->Input_KeyDown( HGEK_UP ) ||
-         hge->Input_KeyDown( HGEK_RIGHT ) )
-    {
-        actionDelta += 1;
-    }
-    if ( hge->Input_KeyDown( HGEK_DOWN ) ||
-         hge->Input_KeyDown( HGEK_LEFT ) )
-    {
-        actionDelta -= 1;
-    }
-    if ( actionDelta != 0 )
-    {
-        int actionType( m_actionType + actionDelta );
-        if ( actionType > 6 )
-        {
-            actionType = 6;
-        }
-        else if ( actionType < 1 )
-        {
-            actionType = 1;
-        }
-        m_actionType = static_cast< ActionType >( actionType );
-    }
-    if ( hge->Input_KeyDown( HGEK_M ) )
-    {
-        m_actionType = TYPE_MOVE;
-    }
-    if ( hge->Input_KeyDown( HGEK_I ) )
-    {
-        m_actionType = TYPE_INVESTIGATE;
-    }
-    if ( hge->Input_KeyDown( HGEK_D ) )
-    {
-        m_actionType = TYPE_RESCUE;
-    }
-    if ( hge->Input_KeyDown( HGEK_A ) )
-    {
-        m_actionType = TYPE_ATTACK;
-    }
-    if ( hge->Input_KeyDown( HGEK_S ) )
-    {
-        m_actionType = TYPE_AIRSTRIKE;
-    }
-    if ( m_mouse.getLeft().clicked() )
-    {
-        b2Vec2 point( 0.0f, 0.0f );
-        hge->Input_GetMousePos( & point.x, & point.y );
-        vp->screenToWorld( point );
-        b2Shape * shapes[9];
-        b2AABB aabb;
-        b2Vec2 epsilon( 0.1f, 0.1f );
-        aabb.lowerBound = point - epsilon;
-        aabb.upperBound = point + epsilon;
-        int num( Engine::b2d()->Query( aabb, shapes, 9 ) );
-        for ( int i = 0; i < num; ++i )
-        {   
-            Entity * picked = static_cast< Entity * >(
-                                shapes[i]->GetBody()->GetUserData() );
-            if ( ! picked->getVisible() )
-            {
-                continue;
-            }
-            switch ( picked->getType() )
-            {
-                case TYPE_GUY:
-                {
-                    Guy * guy( static_cast< Guy * >( picked ) );
-                    if ( guy->getAllegiance() == ALLEGIANCE_ASSET )
-                    {
-                        if ( ! hge->Input_GetKeyState( HGEK_CTRL ) )
-                        {
-                            m_team.clear();
-                        }
-                        if ( std::find( m_team.begin(), m_team.end(), guy ) ==
-                             m_team.end() )
-                        {
-                            m_team.push_back( guy );
-                        }
-                        break;
-                    }
-                }
-                case TYPE_CAR:
-                {
-                    m_picked = picked;
-                    break;
-                }
-                case TYPE_BUILDING:
-                {
-                    Building * building( static_cast< Building * >( picked ) );
-                    m_picked = static_cast< Entity * >(
-                        building->getMeta()->getOwner() );
-                    break;
-                }
-            }
-            break;
-        }
-    }
-    if ( hge->Input_KeyDown( HGEK_MBUTTON ) ||
-         hge->Input_KeyDown( HGEK_SPACE ) )
-    {
-        std::vector< Guy * >::iterator i;
-        for ( i = m_team.begin(); i != m_team.end(); ++i )
-        {
-            Target * target( new Target( m_picked ) );
-            ( * i )->addAction( Action::factory( m_actionType, target ) );
-        }
-    }
-    if ( m_mouse.getRight().clicked() )
-    {
-        b2Vec2 point( 0.0f, 0.0f );
-        hge->Input_GetMousePos( & point.x, & point.y );
-        vp->screenToWorld( point );
-        std::vector< Guy * >::iterator i;
-        for ( i = m_team.begin(); i != m_team.end(); ++i )
-        {
-            Target * target( new Target( point ) );
-            ( * i )->addAction( Action::factory( m_actionType, target ) );
-        }
-    }
-    if ( hge->Input_KeyDown( HGEK_TAB ) && m_team.size() < m_squad.size() )
-    {
-        std::vector< Guy * >::iterator i( m_team.begin() );
-        std::vector< Guy * >::iterator j( i );
-        do
-        {
-            if ( i != m_team.end() )
-            {
-                j = find( m_squad.begin(), m_squad.end(), * i );
-                ++j;
-            }
-            else
-            {
-                j = m_squad.begin();
-            }
-            if ( j == m_squad.end() )
-            {
-                j = m_squad.begin();
-            }
-            if ( i != m_team.end() )
-            {
-                ++i;
-            }
-            if ( i == m_team.end() )
-            {
-                i = m_team.begin();
-            }
-        }
-        while ( find( m_team.begin(), m_team.end(), * j ) != m_team.end() );
-        if ( j != m_squad.end() )
-        {
-            if ( ! hge->Input_GetKeyState( HGEK_CTRL ) )
-            {
-                m_team.clear();
-            }
-            if (std::find( m_team.begin(), m_team.end(), * j ) == m_team.end())
-            {
-                m_team.push_back( * j );
-            }
-        }
-    }
-    if ( hge->Input_KeyDown( HGEK_L ) )
-    {
-        m_lock_camera = ! m_lock_camera;
-    }
-    if ( hge->Input_KeyDown( HGEK_1 ) && m_squad.size() > 0 )
-    {
-        _setViewport( m_squad[0] );
-    }
-    if ( hge->Input_KeyDown( HGEK_2 ) && m_squad.size() > 1 )
-    {
-        _setViewport( m_squad[1] );
-    }
-    if ( hge->Input_KeyDown( HGEK_3 ) && m_squad.size() > 2 )
-    {
-        _setViewport( m_squad[2] );
-    }
-    if ( hge->Input_KeyDown( HGEK_4 ) && m_squad.size() > 3 )
-    {
-        _setViewport( m_squad[3] );
-    }
-    if ( hge->Input_KeyDown( HGEK_5 ) )
-    {
-        _setViewport( m_picked );
-    }
-    if ( hge->Input_KeyDown( HGEK_1 ) )
-    {
-        _setViewport( m_squad[0] );
-    }
-    if ( m_mouse.getLeft().dragging() )
-    {
-        vp->offset().x += m_mouse.getLeft().getDelta().x / vp->hscale();
-        vp->offset().y += m_mouse.getLeft().getDelta().y / vp->vscale();
-    }
-    else if ( m_mouse.getRight().dragging() )
-    {
-        vp->offset().x += m_mouse.getRight().getDelta().x / vp->hscale();
-        vp->offset().y += m_mouse.getRight().getDelta().y / vp->vscale();
-    }
-
-    if ( m_locked != 0 && m_lock_camera )
-    {
-        b2Vec2 position( m_locked->getBody()->GetPosition() );
-        vp->offset() = -1.0f * position;
-        vp->offset().x += 0.5f * vp->bounds().x * vp->hscale();
-        vp->offset().y += 0.5f * vp->bounds().y * vp->vscale();
-    }
-
-    float xmax( 400.0f + 2500.0f - 0.5f * vp->bounds().x );
-    float xmin( 400.0f - 2500.0f + 0.5f * vp->bounds().x );
-    float ymax( 300.0f + 2500.0f - 0.5f * vp->bounds().y );
-    float ymin( 300.0f - 2500.0f + 0.5f * vp->bounds().y );
-
-    xmax += 0.5f / vp->hscale();
-    ymax += 0.5f / vp->vscale();
-    if ( vp->offset().x > xmax )
-    {
-        vp->offset().x = xmax;
-    }
-    if ( vp->offset().x < xmin )
-    {
-        vp->offset().x = xmin;
-    }
-    if ( vp->offset().y > ymax )
-    {
-        vp->offset().y = ymax;
-    }
-    if ( vp->offset().y < ymin )
-    {
-        vp->offset().y = ymin;
-    }
-
-    return false;
-}
-
-//------------------------------------------------------------------------------
-void
-Game::render()
-{
-    HGE * hge( Engine::hge() );
-    ViewPort * vp( Engine::vp() );
-    hgeResourceManager * rm( Engine::rm() );
-
-    hge->Gfx_SetTransform( 400.0f,
-                           300.0f,
-                           vp->offset().x * vp->hscale(),
-                           vp->offset().y * vp->vscale(),
-                           vp->angle(),
-                           vp->hscale(),
-                           vp->vscale() );
-
-    rm->GetSprite( "map11" )->Render( -2000, -2000 );
-    rm->GetSprite( "map21" )->Render( -1000, -2000 );
-    rm->GetSprite( "map31" )->Render( 0, -2000 );
-    rm->GetSprite( "map41" )->Render( 1000, -2000 );
-    rm->GetSprite( "map51" )->Render( 2000, -2000 );
-    rm->GetSprite( "map12" )->Render( -2000, -1000 );
-    rm->GetSprite( "map22" )->Render( -1000, -1000 );
-    rm->GetSprite( "map32" )->Render( 0, -1000 );
-    rm->GetSprite( "map42" )->Render( 1000, -1000 );
-    rm->GetSprite( "map52" )->Render( 2000, -1000 );
-    rm->GetSprite( "map13" )->Render( -2000, 0 );
-    rm->GetSprite( "map23" )->Render( -1000, 0 );
-    rm->GetSprite( "map33" )->Render( 0, 0 );
-    rm->GetSprite( "map43" )->Render( 1000, 0 );
-    rm->GetSprite( "map53" )->Render( 2000, 0 );
-    rm->GetSprite( "map14" )->Render( -2000, 1000 );
-    rm->GetSprite( "map24" )->Render( -1000, 1000 );
-    rm->GetSprite( "map34" )->Render( 0, 1000 );
-    rm->GetSprite( "map44" )->Render( 1000, 1000 );
-    rm->GetSprite( "map54" )->Render( 2000, 1000 );
-    rm->GetSprite( "map15" )->Render( -2000, 2000 );
-    rm->GetSprite( "map25" )->Render( -1000, 2000 );
-    rm->GetSprite( "map35" )->Render( 0, 2000 );
-    rm->GetSprite( "map45" )->Render( 1000, 2000 );
-    rm->GetSprite( "map55" )->Render( 2000, 2000 );
-
-    _renderBodies();        
-    Engine::pm()->Render();
-
-    rm->GetSprite( "shadow11" )->RenderEx( -1250, -1250, 0.0f, 2.5f, 2.5f );
-    rm->GetSprite( "shadow21" )->RenderEx( 1250, -1250, 0.0f, 2.5f, 2.5f );
-    rm->GetSprite( "shadow12" )->RenderEx( -1250, 1250, 0.0f, 2.5f, 2.5f );
-    rm->GetSprite( "shadow22" )->RenderEx( 1250, 1250, 0.0f, 2.5f, 2.5f );
-
-    _renderGuis();        
-
-    float width( 0.5f / vp->hscale() );
-    m_gui->SetColor( 0x55AAFF88 );
-    for ( float i = -2500.0f; i <= 2500.0f; i += 200.0f )
-    {
-        m_gui->RenderStretch( i - width, -2500.0f, i + width, 2500.0f );
-        m_gui->RenderStretch( -2500.0f, i - width, 2500.0f, i + width );
-    }
-    m_gui->SetColor( 0x88FFFF88 );
-    for ( float i = -2500.0f; i <= 2500.0f; i += 1000.0f )
-    {
-        m_gui->RenderStretch( i - width, -2500.0f, i + width, 2500.0f );
-        m_gui->RenderStretch( -2500.0f, i - width, 2500.0f, i + width );
-    }
-
-    if ( m_picked != 0 )
-    {
-        const b2AABB & aabb( m_picked->getAABB() );
-        _renderTarget( m_picked->getColor(), aabb );
-    }
-    std::vector< Guy * >::iterator i;
-    for ( i = m_team.begin(); i != m_team.end(); ++i )
-    {
-        const b2AABB & aabb( ( * i )->getAABB() );
-        _renderTarget( ( * i )->getColor(), aabb );
-    }
-
-    hge->Gfx_SetTransform();
-    _renderGui();
-}
-
-//------------------------------------------------------------------------------
-// private
-//------------------------------------------------------------------------------
-void
-Game::_updateCars( float dt )
-{
-    std::vector< Car * >::iterator i;
-    for ( i = m_cars.begin(); i != m_cars.end();  ++i )
-    {
-        ( * i )->update( dt );
-        if ( ( * i )->isDestroyed() )
-        {
-            // TODO: eject occupants, explode, replace with charred body
-        }
-    }
-}
-
-//------------------------------------------------------------------------------
-void
-Game::_updateGuys( float dt )
-{
-    std::vector< Guy * >::iterator i;
-    for ( i = m_guys.begin(); i != m_guys.end(); ++i )
-    {
-        ( * i )->update( dt );
-        if ( ( * i )->isDestroyed() )
-        {
-            // TODO: replace with crucifix
-        }
-    }
-}
-
-//------------------------------------------------------------------------------
-void
-Game::_updateBuildings( float dt )
-{
-    std::vector< Building * >::iterator i;
-    for ( i = m_buildings.begin(); i != m_buildings.end(); ++i )
-    {
-        ( * i )->update( dt );
-        if ( ( * i )->getMeta()->isDestroyed() &&
-             ( * i )->getMeta()->getOwner() == ( * i ) )
-        {
-            // TODO: eject occupants
-        }
-    }
-}
-
-//------------------------------------------------------------------------------
-void
-Game::_renderBodies()
-{
-    ViewPort * vp( Engine::vp() );
-    b2World * b2d( Engine::b2d() );
-
-    for ( b2Body * body( b2d->GetBodyList() ); body != NULL;
-          body = body->GetNext() )
-    {
-        if ( body->IsDynamic() )
-        {
-            Entity * entity( static_cast<Entity *>( body->GetUserData() ) );
-            if ( entity )
-            {
-                entity->render();
-            }   
-        }
-    }   
-}   
-
-//------------------------------------------------------------------------------
-void
-Game::_renderGuis()
-{
-    ViewPort * vp( Engine::vp() );
-    b2World * b2d( Engine::b2d() );
-
-    for ( b2Body * body( b2d->GetBodyList() ); body != NULL;
-          body = body->GetNext() )
-    {
-        Entity * entity( static_cast<Entity *>( body->GetUserData() ) );
-        if ( entity )
-        {
-            switch ( entity->getType() )
-            {
-                case TYPE_CAR:
-                case TYPE_BUILDING:
-                case TYPE_GUY:
-                {
-                    entity->renderGui( m_gui, m_zoom, m_picked );
-                }
-            }
-        }   
-    }   
-}   
-
-//------------------------------------------------------------------------------
-void
-Game::_renderTarget( DWORD color, const b2AABB & aabb )
-{
-    HGE * hge( Engine::hge() );
-    ViewPort * vp( Engine::vp() );
-    float width( 7.0f / vp->hscale() );
-    float height( 7.0f / vp->vscale() );
-    float dx( 2.0f / vp->hscale() );
-    float dy( 2.0f / vp->vscale() );
-    m_gui->SetColor( color );
-    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.lowerBound.y - height,
-                          aabb.lowerBound.x, aabb.lowerBound.y - height + dy );
-    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.lowerBound.y - height,
-                          aabb.lowerBound.x - width + dx, aabb.lowerBound.y );
-    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.lowerBound.y - height,
-                          aabb.upperBound.x, aabb.lowerBound.y - height + dy );
-    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.lowerBound.y - height,
-                          aabb.upperBound.x + width - dx, aabb.lowerBound.y );
-    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.upperBound.y + height,
-                          aabb.upperBound.x, aabb.upperBound.y + height - dy );
-    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.upperBound.y + height,
-                          aabb.upperBound.x + width - dx, aabb.upperBound.y );
-    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.upperBound.y + height,
-                          aabb.lowerBound.x, aabb.upperBound.y + height - dy );
-    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.upperBound.y + height,
-                          aabb.lowerBound.x - width + dx, aabb.upperBound.y );
-}
-
-//------------------------------------------------------------------------------
-void
-Game::_renderGui()
-{
-    HGE * hge( Engine::hge() );
-    hgeResourceManager * rm( Engine::rm() );
-    float width =
-        static_cast< float >( hge->System_GetState( HGE_SCREENWIDTH ) );
-    float height =
-        static_cast< float >( hge->System_GetState( HGE_SCREENHEIGHT ) );
-    hgeFont * font( rm->GetFont( "dialogue" ) );
-    font->SetColor( 0xFFFFCCFF );
-    ViewPort * vp( Engine::vp() );
-    b2Vec2 mouse( 0.0f, 0.0f );
-    hge->Input_GetMousePos( & mouse.x, & mouse.y );
-    b2Vec2 point( mouse );
-    vp->screenToWorld( point );
-
-    if ( m_lock_camera )
-    {
-        font->printf( 10.0f, 10.0f, HGETEXT_LEFT, "CAMERA LOCKED" );
-    }
-
-    m_gui->SetColor( 0x88000000 );
-    m_gui->RenderStretch( 540.0f, 6.0f, 740.0f, 25.0f );
-
-    font->printf( 640.0f, 10.0f, HGETEXT_CENTER, "%s -> %s %s",
-                  ACTION_NAME[m_actionType],
-                  m_picked->getAllegianceName(),
-                  m_picked->getTypeName() );
-
-    m_gui->RenderStretch( 300.0f, 776.0F, 980.0f, 795.0f );
-    for ( unsigned int i = 0; i < m_squad.size(); ++i )
-    {
-        if (std::find( m_team.begin(),m_team.end(),m_squad[i]) != m_team.end() )
-        {
-            font->printf( 390.0f + 160.0f * i, 780.0f, HGETEXT_CENTER,
-                          "[%s]", m_squad[i]->getName() );
-        }
-        else
-        {
-            font->printf( 390.0f + 160.0f * i, 780.0f, HGETEXT_CENTER,
-                          m_squad[i]->getName() );
-        }
-        font->printf( 310.0f + 160.0f * i, 780.0f, HGETEXT_CENTER, "|" );
-    }
-    font->printf( 960.0f, 780.0f, HGETEXT_CENTER, "|" );
-
-    hge->Gfx_RenderLine( 0.0f, mouse.y, mouse.x - 5.0f, mouse.y, 0xCCFFFFFF );
-    hge->Gfx_RenderLine( mouse.x + 5.0f, mouse.y, 800.0f, mouse.y, 0xCCFFFFFF );
-    hge->Gfx_RenderLine( mouse.x, 0.0f, mouse.x, mouse.y - 5.0f, 0xCCFFFFFF );
-    hge->Gfx_RenderLine( mouse.x, mouse.y + 5.0f, mouse.x, 600.0f, 0xCCFFFFFF );
-    hge->Gfx_RenderLine( mouse.x - 6.0f, mouse.y - 10.0f,
-                         mouse.x + 6.0f, mouse.y - 10.0f, 0xEEFFFFFF ); 
-    hge->Gfx_RenderLine( mouse.x + 10.0f, mouse.y - 6.0f,
-                         mouse.x + 10.0f, mouse.y + 6.0f, 0xEEFFFFFF ); 
-    hge->Gfx_RenderLine( mouse.x + 6.0f, mouse.y + 10.0f,
-                         mouse.x - 6.0f, mouse.y + 10.0f, 0xEEFFFFFF ); 
-    hge->Gfx_RenderLine( mouse.x - 10.0f, mouse.y + 6.0f,
-                         mouse.x - 10.0f, mouse.y - 6.0f, 0xEEFFFFFF ); 
-}
-
-//------------------------------------------------------------------------------
-void
-Game::_setViewport( Entity * entity )
-{
-    if ( entity == 0 || entity->getBody() == 0 )
-    {
-        return;
-    }
-    m_locked = entity;
-    ViewPort * vp( Engine::vp() );
-    b2Vec2 position( entity->getBody()->GetPosition() );
-    vp->offset() = -1.0f * position;
-    vp->offset().x += 0.5f * vp->bounds().x * vp->hscale();
-    vp->offset().y += 0.5f * vp->bounds().y * vp->vscale();
-}
-
-//==============================================================================
+//==============================================================================
+
+#include <algorithm>
+
+#include <hgeresource.h>
+#include <hgesprite.h>
+#include <hgefont.h>
+
+#include <game.hpp>
+#include <engine.hpp>
+#include <entity.hpp>
+#include <viewport.hpp>
+#include <score.hpp>
+#include <cache.hpp>
+#include <savegame.hpp>
+#include <replay.hpp>
+#include <random.hpp>
+#include <navigation.hpp>
+#include <visibility.hpp>
+#include <fog.hpp>
+#include <shards.hpp>
+#include <labels.hpp>
+#include <scheduler.hpp>
+#include <influence.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const char * ACTION_NAME[] =
+    {
+        "",
+        "Move",
+        "Halt",
+        "Identify",
+        "Detain",
+        "Attack",
+        "Shock"
+    };
+
+    const char * SAVE_FILE( "urban_warfare.sav" );
+    const float AUTOSAVE_INTERVAL( 5.0f );
+    const int GROUND_TILES( 5 );
+    const float GROUND_SIZE( 1000.0f );
+    const int SHADOW_TILES( 2 );
+    const float SHADOW_SCALE( 2.5f );
+    const unsigned int STREAM_BENCHMARK( 1000 );
+    const unsigned int BENCHMARK_ROUNDS( 4 );
+    const unsigned int STREAM_CROWD( 2000 );
+    const int CROWD_SIZE( 4000 );
+    const int CROWD_STEPS( 300 );
+    const unsigned int AI_BUDGET( 500 );
+    const float HIDDEN_PRIORITY( 1000.0f );
+};
+
+//------------------------------------------------------------------------------
+Mouse::MouseButton::MouseButton()
+    :
+    m_state( MOUSE_START ),
+    m_action( ACTION_NONE ),
+    m_timer(),
+    m_last( 0.0f, 0.0f ),
+    m_delta( 0.0f, 0.0f ),
+    m_total( 0.0f, 0.0f ),
+    m_origin( 0.0f, 0.0f )
+{
+}
+
+//------------------------------------------------------------------------------
+Mouse::MouseButton::~MouseButton()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+Mouse::MouseButton::clear()
+{
+    m_state = MOUSE_START;
+    m_action = ACTION_NONE;
+    m_timer = 0.0f;
+    Engine::hge()->Input_GetMousePos( & m_last.x, & m_last.y );
+    m_delta.SetZero();
+    m_total.SetZero();
+    m_origin = m_last;
+}
+
+//------------------------------------------------------------------------------
+void
+Mouse::MouseButton::update( float dt, bool state )
+{
+    m_timer += dt;
+
+    b2Vec2 position( 0.0f, 0.0f );
+    Engine::hge()->Input_GetMousePos( & position.x, & position.y );
+    m_delta = position - m_last;
+    m_total += m_delta;
+    m_last = position;
+
+    float offset( m_total.LengthSquared() );
+
+    switch ( m_state )
+    {
+        case MOUSE_START:
+        {
+            if ( state )
+            {
+                m_timer = 0.0f;
+                m_state = MOUSE_FIRST_DOWN;
+                m_total.SetZero();
+                m_origin = position;
+            }
+            {
+                m_action = ACTION_NONE;
+            }
+            break;
+        }
+        case MOUSE_FIRST_DOWN:
+        {
+            if ( ! state )
+            {
+                m_timer = 0.0f;
+                m_state = MOUSE_FIRST_UP;
+                m_total.SetZero();
+            }
+            else if ( m_timer > 0.2f || offset > 9.0f )
+            {
+                m_action = ACTION_DRAGGING;
+                m_state = MOUSE_END;
+            }
+            break;
+        }
+        case MOUSE_FIRST_UP:
+        {
+            if ( state )
+            {
+                m_timer = 0.0f;
+                m_state = MOUSE_SECOND_DOWN;
+                m_total.SetZero();
+                m_origin = position;
+            }
+            else if ( m_timer > 0.1f || offset > 1.0f )
+            {
+                m_action = ACTION_CLICKED;
+                m_state = MOUSE_START;
+            }
+            break;
+        }
+        case MOUSE_SECOND_DOWN:
+        {
+            if ( ! state )
+            {
+                m_timer = 0.0f;
+                m_state = MOUSE_SECOND_UP;
+                m_total.SetZero();
+            }
+            if ( m_timer > 0.2f || offset > 9.0f )
+            {
+                m_action = ACTION_DRAGGING;
+                m_state = MOUSE_END;
+            }
+            break;
+        }
+        case MOUSE_SECOND_UP:
+        {
+            m_action = ACTION_DOUBLED;
+            m_state = MOUSE_START;
+            break;
+        }
+        case MOUSE_END:
+        {
+            if ( ! state )
+            {
+                m_action = ACTION_DROPPED;
+                m_state = MOUSE_START;
+            }
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+Mouse::MouseButton::dragging() const
+{
+    return m_action == ACTION_DRAGGING;
+}
+
+//------------------------------------------------------------------------------
+bool
+Mouse::MouseButton::clicked() const
+{
+    return m_action == ACTION_CLICKED;
+}
+
+//------------------------------------------------------------------------------
+bool
+Mouse::MouseButton::doubleClicked() const
+{
+    return m_action == ACTION_DOUBLED;
+}
+
+//------------------------------------------------------------------------------
+bool
+Mouse::MouseButton::dropped() const
+{
+    return m_action == ACTION_DROPPED;
+}
+
+//------------------------------------------------------------------------------
+const b2Vec2 &
+Mouse::MouseButton::getDelta() const
+{
+    return m_delta;
+}
+
+//------------------------------------------------------------------------------
+// Where the button last went down, in screen coordinates.
+const b2Vec2 &
+Mouse::MouseButton::getOrigin() const
+{
+    return m_origin;
+}
+
+//==============================================================================
+Mouse::Mouse()
+    :
+    m_left(),
+    m_right()
+{
+}
+
+//------------------------------------------------------------------------------
+Mouse::~Mouse()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+Mouse::clear()
+{
+    m_left.clear();
+    m_right.clear();
+}
+
+//------------------------------------------------------------------------------
+void
+Mouse::update( float dt )
+{
+    m_left.update( dt, Engine::hge()->Input_GetKeyState( HGEK_LBUTTON ) ); 
+    m_right.update( dt, Engine::hge()->Input_GetKeyState( HGEK_RBUTTON ) ); 
+}
+
+//------------------------------------------------------------------------------
+const Mouse::MouseButton &
+Mouse::getLeft()
+{
+    return m_left;
+}
+
+//------------------------------------------------------------------------------
+const Mouse::MouseButton &
+Mouse::getRight()
+{
+    return m_right;
+}
+
+//==============================================================================
+Game::Game()
+    :
+    Context(),
+    m_gui( 0 ),
+    m_zoom( 2 ),
+    m_cars(),
+    m_trees(),
+    m_guys(),
+    m_buildings(),
+    m_parked(),
+    m_picked( 0 ),
+    m_team(),
+    m_members(),
+    m_squad(),
+    m_selecting( false ),
+    m_actionType( TYPE_MOVE ),
+    m_lock_camera( false ),
+    m_locked( 0 ),
+    m_mouse(),
+    m_save( 0 ),
+    m_autosave( 0.0f ),
+    m_replay( 0 ),
+    m_visibility( 0 ),
+    m_fog( 0 ),
+    m_labels( 0 ),
+    m_scheduler( 0 ),
+    m_decided()
+{
+}
+
+//------------------------------------------------------------------------------
+Game::~Game()
+{
+}
+
+//------------------------------------------------------------------------------
+// public:
+//------------------------------------------------------------------------------
+void
+Game::init()
+{
+    HGE * hge( Engine::hge() );
+    b2World * b2d( Engine::b2d() );
+    hgeResourceManager * rm( Engine::rm() );
+    ViewPort * vp( Engine::vp() );
+
+    vp->setOffset( b2Vec2( 1742.0f, 2349.0f ) );
+    vp->setBounds( b2Vec2( 800.0f, 600.0f ) );
+
+    m_zoom = 3;
+    m_picked = 0;
+    m_actionType = TYPE_MOVE;
+    m_lock_camera = false;
+    m_locked = 0;
+
+    m_gui = new hgeSprite( 0, 0, 0, 1, 1 );
+
+    // Looking sprites up by name is a walk through the resource list, so the
+    // map layers are fetched once here rather than every frame.
+    char name[16];
+    for ( int y = 0; y < GROUND_TILES; ++y )
+    {
+        for ( int x = 0; x < GROUND_TILES; ++x )
+        {
+            sprintf_s( name, 15, "map%d%d", x + 1, y + 1 );
+            m_ground[y * GROUND_TILES + x] = rm->GetSprite( name );
+        }
+    }
+    for ( int y = 0; y < SHADOW_TILES; ++y )
+    {
+        for ( int x = 0; x < SHADOW_TILES; ++x )
+        {
+            sprintf_s( name, 15, "shadow%d%d", x + 1, y + 1 );
+            m_shadows[y * SHADOW_TILES + x] = rm->GetSprite( name );
+        }
+    }
+
+    // A freshly loaded world is restored as well, so that every mission, and
+    // every replay of it, starts with the world in the same state.
+    WorldCache * wc( Engine::wc() );
+    if ( ! wc->isLoaded() )
+    {
+        wc->load();
+    }
+    wc->restore();
+
+    m_buildings = wc->getBuildings();
+    m_trees = wc->getTrees();
+    m_parked = wc->getParked();
+    m_cars = wc->getCars();
+    m_guys = wc->getGuys();
+    m_squad = wc->getSquad();
+
+    m_team.clear();
+    m_members.clear();
+    m_selecting = false;
+    _select( m_squad.front(), false );
+
+    m_visibility = new Visibility();
+    m_visibility->bake( m_buildings );
+    m_fog = new Fog();
+    m_fog->init( m_visibility );
+    m_labels = new Labels( Engine::rm()->GetFont( "dialogue" ) );
+    m_labels->setGroupName( ALLEGIANCE_UNKNOWN, "unknown" );
+    m_labels->setGroupName( ALLEGIANCE_ASSET, "assets" );
+    m_labels->setGroupName( ALLEGIANCE_FRIENDLY, "friendly" );
+    m_labels->setGroupName( ALLEGIANCE_HOSTILE, "hostile" );
+    m_scheduler = new Scheduler();
+    m_scheduler->setBudget( AI_BUDGET );
+    Engine::im()->clear();
+
+    b2Vec2 offset( 100.0f, 100.0f );
+    b2Vec2 position( m_team.back()->getBody()->GetPosition() );
+    b2Shape * shapes[99];
+    b2AABB aabb;
+    aabb.lowerBound = position - offset;
+    aabb.upperBound = position + offset;
+    int num( Engine::b2d()->Query( aabb, shapes, 99 ) );
+    for ( int i = 0; i < num; ++i )
+    {
+        Entity * entity =
+            static_cast< Entity * >( shapes[0]->GetBody()->GetUserData() );
+        if ( entity->getType() == TYPE_BUILDING )
+        {
+            m_picked = entity->getHandle();
+            break;
+        }
+    }
+    _setViewport( Entity::lookup( m_picked ) );
+
+    m_mouse.clear();
+
+    m_save = new SaveGame( SAVE_FILE );
+    m_autosave = 0.0f;
+
+    // Everything random in the simulation comes from this seed, so recording
+    // it along with the orders is enough to replay the mission.
+    int seed( static_cast< int >( GetTickCount() ) );
+    Random::seed( seed );
+    m_replay = new Replay();
+    m_replay->start( seed, wc->getEntities() );
+
+    HMUSIC music = Engine::rm()->GetMusic( "game" );
+    Engine::hge()->Music_Play( music, true, 50, 0, 0 );
+}
+
+//------------------------------------------------------------------------------
+void
+Game::fini()
+{
+    delete m_save;
+    m_save = 0;
+    delete m_replay;
+    m_replay = 0;
+    delete m_fog;
+    m_fog = 0;
+    delete m_labels;
+    m_labels = 0;
+    delete m_scheduler;
+    m_scheduler = 0;
+    m_decided.clear();
+    Engine::im()->clear();
+    delete m_visibility;
+    m_visibility = 0;
+
+    // The world itself belongs to the cache; park it at its initial state so
+    // that it sleeps while we're away and is ready for the next mission.
+    Engine::wc()->restore();
+
+    m_cars.clear();
+    m_trees.clear();
+    m_guys.clear();
+    m_buildings.clear();
+    m_parked.clear();
+    m_team.clear();
+    m_members.clear();
+    m_squad.clear();
+    m_picked = 0;
+    m_locked = 0;
+
+    Engine::hge()->Channel_StopAll();
+    delete m_gui;
+    m_gui = 0;
+}
+
+//------------------------------------------------------------------------------
+bool
+Game::update( float dt )
+{
+    HGE * hge( Engine::hge() );
+    b2World * b2d( Engine::b2d() );
+    ViewPort * vp( Engine::vp() );
+
+    if ( hge->Input_GetKeyState( HGEK_ESCAPE ) &&
+         Engine::instance()->isPaused() )
+    {
+        Engine::instance()->switchContext( STATE_MENU );
+        return false;
+    }
+
+        /*
+        Engine::instance()->switchContext( STATE_SCORE );
+        Score * score( static_cast< Score * >(
+            Engine::instance()->getContext() ) );
+        score->calculateScore( 0, 0, 0, 0 );
+        return false;
+        */
+
+    // Nothing is simulated while we're paused, and the replay knows it.
+    bool paused( Engine::instance()->isPaused() );
+    _reclaim();
+    if ( ! paused )
+    {
+        _simulate( dt );
+        _think();
+    }
+    m_replay->tick( dt, paused, Engine::wc()->getEntities() );
+    m_visibility->update( m_squad, Engine::wc()->getEntities() );
+    m_fog->update();
+
+    m_autosave += dt;
+    if ( m_autosave > AUTOSAVE_INTERVAL || hge->Input_KeyDown( HGEK_F5 ) )
+    {
+        _saveGame();
+    }
+    if ( hge->Input_KeyDown( HGEK_F9 ) )
+    {
+        _loadGame();
+    }
+    if ( hge->Input_KeyDown( HGEK_R ) && Engine::instance()->isDebug() )
+    {
+        _playReplay();
+    }
+    if ( hge->Input_KeyDown( HGEK_N ) && Engine::instance()->isDebug() )
+    {
+        _benchmarkNavigation();
+    }
+    if ( hge->Input_KeyDown( HGEK_B ) && Engine::instance()->isDebug() )
+    {
+        _benchmarkPhysics();
+    }
+
+    m_mouse.update( dt );
+
+    if ( m_mouse.getLeft().doubleClicked() )
+    {
+        m_zoom += 1;
+        if ( m_zoom > 3 )
+        {
+            m_zoom = 3;
+        }
+        else
+        {
+            b2Vec2 point( 0.0f, 0.0f );
+            hge->Input_GetMousePos( & point.x, & point.y );
+            vp->moveOffset( b2Vec2( ( 400.0f - point.x ) / vp->hscale(),
+                                    ( 300.0f - point.y ) / vp->hscale() ) );
+            hge->Input_SetMousePos( 400.0f, 300.0f );
+        }
+    }
+    if ( m_mouse.getRight().doubleClicked() )
+    {
+        m_zoom -= 1;
+        if ( m_zoom < 1 )
+        {
+            m_zoom = 1;
+        }
+        else
+        {
+            b2Vec2 point( 0.0f, 0.0f );
+            hge->Input_GetMousePos( & point.x, & point.y );
+            vp->moveOffset( b2Vec2( ( 400.0f - point.x ) / vp->hscale(),
+                                    ( 300.0f - point.y ) / vp->hscale() ) );
+            hge->Input_SetMousePos( 400.0f, 300.0f );
+        }
+    }
+    switch ( m_zoom )
+    {
+        case 1:
+        {
+            vp->setBounds( b2Vec2( 1600.0f, 1200.0f ) );
+            break;
+        }
+        case 2:
+        {
+            vp->setBounds( b2Vec2( 800.0f, 600.0f ) );
+            break;
+        }
+        case 3:
+        {
+            vp->setBounds( b2Vec2( 400.0f, 300.0f ) );
+            break;
+        }
+    }
+    int actionDelta( hge->Input_GetMouseWheel() );
+    if ( hge->Input_KeyDown( HGEK_UP ) ||
+         hge->Input_KeyDown( HGEK_RIGHT ) )
+    {
+        actionDelta += 1;
+    }
+    if ( hge->Input_KeyDown( HGEK_DOWN ) ||
+         hge->Input_KeyDown( HGEK_LEFT ) )
+    {
+        actionDelta -= 1;
+    }
+    if ( actionDelta != 0 )
+    {
+        int actionType( m_actionType + actionDelta );
+        if ( actionType > 6 )
+        {
+            actionType = 6;
+        }
+        else if ( actionType < 1 )
+        {
+            actionType = 1;
+        }
+        m_actionType = static_cast< ActionType >( actionType );
+    }
+    if ( hge->Input_KeyDown( HGEK_M ) )
+    {
+        m_actionType = TYPE_MOVE;
+    }
+    if ( hge->Input_KeyDown( HGEK_I ) )
+    {
+        m_actionType = TYPE_INVESTIGATE;
+    }
+    if ( hge->Input_KeyDown( HGEK_D ) )
+    {
+        m_actionType = TYPE_RESCUE;
+    }
+    if ( hge->Input_KeyDown( HGEK_A ) )
+    {
+        m_actionType = TYPE_ATTACK;
+    }
+    if ( hge->Input_KeyDown( HGEK_S ) )
+    {
+        m_actionType = TYPE_AIRSTRIKE;
+    }
+    if ( m_mouse.getLeft().clicked() )
+    {
+        b2Vec2 point( 0.0f, 0.0f );
+        hge->Input_GetMousePos( & point.x, & point.y );
+        vp->screenToWorld( point );
+        b2Shape * shapes[9];
+        b2AABB aabb;
+        b2Vec2 epsilon( 0.1f, 0.1f );
+        aabb.lowerBound = point - epsilon;
+        aabb.upperBound = point + epsilon;
+        int num( Engine::b2d()->Query( aabb, shapes, 9 ) );
+        for ( int i = 0; i < num; ++i )
+        {   
+            Entity * picked = static_cast< Entity * >(
+                                shapes[i]->GetBody()->GetUserData() );
+            if ( ! picked->getVisible() )
+            {
+                continue;
+            }
+            switch ( picked->getType() )
+            {
+                case TYPE_GUY:
+                {
+                    Guy * guy( static_cast< Guy * >( picked ) );
+                    if ( guy->getAllegiance() == ALLEGIANCE_ASSET )
+                    {
+                        _select( guy, hge->Input_GetKeyState( HGEK_CTRL ) );
+                        break;
+                    }
+                }
+                case TYPE_CAR:
+                {
+                    m_picked = picked->getHandle();
+                    break;
+                }
+                case TYPE_BUILDING:
+                {
+                    Building * building( static_cast< Building * >( picked ) );
+                    m_picked = static_cast< Entity * >(
+                        building->getMeta()->getOwner() )->getHandle();
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    if ( hge->Input_KeyDown( HGEK_MBUTTON ) ||
+         hge->Input_KeyDown( HGEK_SPACE ) )
+    {
+        _giveOrder( m_actionType, Entity::lookup( m_picked ),
+                    b2Vec2( 0.0f, 0.0f ), m_team );
+    }
+    if ( m_mouse.getRight().clicked() )
+    {
+        b2Vec2 point( 0.0f, 0.0f );
+        hge->Input_GetMousePos( & point.x, & point.y );
+        vp->screenToWorld( point );
+        _giveOrder( m_actionType, 0, point, m_team );
+    }
+    if ( hge->Input_KeyDown( HGEK_TAB ) && m_team.size() < m_squad.size() )
+    {
+        unsigned int start( 0 );
+        if ( m_team.size() > 0 )
+        {
+            start = static_cast< unsigned int >(
+                std::find( m_squad.begin(), m_squad.end(), m_team.back() ) -
+                m_squad.begin() ) + 1;
+        }
+        for ( unsigned int i = 0; i < m_squad.size(); ++i )
+        {
+            Guy * guy( m_squad[( start + i ) % m_squad.size()] );
+            if ( ! _isSelected( guy ) )
+            {
+                _select( guy, hge->Input_GetKeyState( HGEK_CTRL ) );
+                break;
+            }
+        }
+    }
+    if ( hge->Input_KeyDown( HGEK_L ) )
+    {
+        m_lock_camera = ! m_lock_camera;
+    }
+    if ( hge->Input_KeyDown( HGEK_1 ) && m_squad.size() > 0 )
+    {
+        _setViewport( m_squad[0] );
+    }
+    if ( hge->Input_KeyDown( HGEK_2 ) && m_squad.size() > 1 )
+    {
+        _setViewport( m_squad[1] );
+    }
+    if ( hge->Input_KeyDown( HGEK_3 ) && m_squad.size() > 2 )
+    {
+        _setViewport( m_squad[2] );
+    }
+    if ( hge->Input_KeyDown( HGEK_4 ) && m_squad.size() > 3 )
+    {
+        _setViewport( m_squad[3] );
+    }
+    if ( hge->Input_KeyDown( HGEK_5 ) )
+    {
+        _setViewport( Entity::lookup( m_picked ) );
+    }
+    if ( m_mouse.getLeft().dropped() && m_selecting )
+    {
+        b2Vec2 point( 0.0f, 0.0f );
+        hge->Input_GetMousePos( & point.x, & point.y );
+        _selectBox( m_mouse.getLeft().getOrigin(), point,
+                    hge->Input_GetKeyState( HGEK_CTRL ) );
+        m_selecting = false;
+    }
+    if ( m_mouse.getLeft().dragging() )
+    {
+        if ( hge->Input_GetKeyState( HGEK_SHIFT ) )
+        {
+            m_selecting = true;
+        }
+        if ( ! m_selecting )
+        {
+            const b2Vec2 & delta( m_mouse.getLeft().getDelta() );
+            vp->moveOffset( b2Vec2( delta.x / vp->hscale(),
+                                    delta.y / vp->vscale() ) );
+        }
+    }
+    else if ( m_mouse.getRight().dragging() )
+    {
+        const b2Vec2 & delta( m_mouse.getRight().getDelta() );
+        vp->moveOffset( b2Vec2( delta.x / vp->hscale(),
+                                delta.y / vp->vscale() ) );
+    }
+
+    Entity * locked( Entity::lookup( m_locked ) );
+    if ( locked != 0 && m_lock_camera )
+    {
+        b2Vec2 position( locked->getBody()->GetPosition() );
+        b2Vec2 offset( -1.0f * position );
+        offset.x += 0.5f * vp->bounds().x * vp->hscale();
+        offset.y += 0.5f * vp->bounds().y * vp->vscale();
+        vp->setOffset( offset );
+    }
+
+    float xmax( 400.0f + 2500.0f - 0.5f * vp->bounds().x );
+    float xmin( 400.0f - 2500.0f + 0.5f * vp->bounds().x );
+    float ymax( 300.0f + 2500.0f - 0.5f * vp->bounds().y );
+    float ymin( 300.0f - 2500.0f + 0.5f * vp->bounds().y );
+
+    xmax += 0.5f / vp->hscale();
+    ymax += 0.5f / vp->vscale();
+    b2Vec2 offset( vp->offset() );
+    if ( offset.x > xmax )
+    {
+        offset.x = xmax;
+    }
+    if ( offset.x < xmin )
+    {
+        offset.x = xmin;
+    }
+    if ( offset.y > ymax )
+    {
+        offset.y = ymax;
+    }
+    if ( offset.y < ymin )
+    {
+        offset.y = ymin;
+    }
+    vp->setOffset( offset );
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void
+Game::render()
+{
+    HGE * hge( Engine::hge() );
+    ViewPort * vp( Engine::vp() );
+
+    vp->apply( hge );
+
+    b2AABB view;
+    vp->getView( view );
+    _renderGround( view );
+
+    _renderBodies();        
+    Engine::pm()->Render();
+
+    _renderShadows( view );
+
+    m_fog->render();
+
+    _renderGuis();        
+
+    float width( 0.5f / vp->hscale() );
+    m_gui->SetColor( 0x55AAFF88 );
+    for ( float i = -2500.0f; i <= 2500.0f; i += 200.0f )
+    {
+        m_gui->RenderStretch( i - width, -2500.0f, i + width, 2500.0f );
+        m_gui->RenderStretch( -2500.0f, i - width, 2500.0f, i + width );
+    }
+    m_gui->SetColor( 0x88FFFF88 );
+    for ( float i = -2500.0f; i <= 2500.0f; i += 1000.0f )
+    {
+        m_gui->RenderStretch( i - width, -2500.0f, i + width, 2500.0f );
+        m_gui->RenderStretch( -2500.0f, i - width, 2500.0f, i + width );
+    }
+
+    Entity * picked( Entity::lookup( m_picked ) );
+    if ( picked != 0 )
+    {
+        const b2AABB & aabb( picked->getAABB() );
+        _renderTarget( picked->getColor(), aabb );
+    }
+    std::vector< Guy * >::iterator i;
+    for ( i = m_team.begin(); i != m_team.end(); ++i )
+    {
+        const b2AABB & aabb( ( * i )->getAABB() );
+        _renderTarget( ( * i )->getColor(), aabb );
+    }
+
+    hge->Gfx_SetTransform();
+    _renderGui();
+}
+
+//------------------------------------------------------------------------------
+// private
+//------------------------------------------------------------------------------
+void
+Game::_simulate( float dt )
+{
+    Random::advance();
+    _updateCars( dt );
+    _updateGuys( dt );
+    _updateBuildings( dt );
+    Engine::im()->update( Engine::wc()->getEntities() );
+}
+
+//------------------------------------------------------------------------------
+// Idle civilians asked for a decision while they were being updated, and as
+// many of them as the budget allows now get one.
+void
+Game::_think()
+{
+    m_scheduler->run( m_decided );
+    m_replay->decide( m_decided );
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_giveOrder( ActionType action, Entity * target, const b2Vec2 & point,
+                  const std::vector< Guy * > & team )
+{
+    m_replay->order( action, target, point, team );
+
+    if ( action == TYPE_MOVE && team.size() > 1 )
+    {
+        std::vector< Entity * > members( team.begin(), team.end() );
+        GroupOrder * group( new GroupOrder( target != 0 ? new Target( target )
+                                                        : new Target( point ),
+                                            members ) );
+        for ( unsigned int i = 0; i < team.size(); ++i )
+        {
+            team[i]->addAction( new MoveAction( group, group->getSlot( i ) ) );
+        }
+        return;
+    }
+
+    std::vector< Guy * >::const_iterator i;
+    for ( i = team.begin(); i != team.end(); ++i )
+    {
+        Target * order( target != 0 ? new Target( target )
+                                    : new Target( point ) );
+        ( * i )->addAction( Action::factory( action, order ) );
+    }
+}
+
+//------------------------------------------------------------------------------
+// The team keeps the order in which assets were picked, and the set answers
+// whether an asset is in it without a walk through the team.
+void
+Game::_select( Guy * guy, bool add )
+{
+    if ( ! add )
+    {
+        m_team.clear();
+        m_members.clear();
+    }
+    if ( m_members.insert( guy ).second )
+    {
+        m_team.push_back( guy );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Picks every visible asset inside a rectangle given in screen coordinates.
+// There are only ever a few assets, so they're tested directly; a query of the
+// broadphase would have to wade through everything else in the rectangle too.
+// Dragging out an empty rectangle leaves the team as it was.
+void
+Game::_selectBox( const b2Vec2 & from, const b2Vec2 & to, bool add )
+{
+    b2Vec2 corners[2] = { from, to };
+    Engine::vp()->screenToWorld( corners, 2 );
+    b2AABB aabb;
+    aabb.lowerBound = b2Min( corners[0], corners[1] );
+    aabb.upperBound = b2Max( corners[0], corners[1] );
+
+    std::vector< Guy * >::iterator i;
+    for ( i = m_squad.begin(); i != m_squad.end(); ++i )
+    {
+        Guy * guy( * i );
+        if ( ! guy->getVisible() || guy->getAllegiance() != ALLEGIANCE_ASSET )
+        {
+            continue;
+        }
+        if ( ! b2TestOverlap( guy->getAABB(), aabb ) )
+        {
+            continue;
+        }
+        _select( guy, add );
+        add = true;
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+Game::_isSelected( Guy * guy )
+{
+    return m_members.find( guy ) != m_members.end();
+}
+
+//------------------------------------------------------------------------------
+// Gets rid of whatever left the world during the last step. Handles to it go
+// stale by themselves once the cache deletes it, but anything that's busy with
+// it is interrupted and the squad lets go of it first.
+void
+Game::_reclaim()
+{
+    WorldCache * wc( Engine::wc() );
+    const std::vector< Entity * > & entities( wc->getEntities() );
+    b2Body * body( 0 );
+    while ( ( body = Engine::instance()->popViolation() ) != 0 )
+    {
+        Entity * entity( static_cast< Entity * >( body->GetUserData() ) );
+        if ( entity == 0 )
+        {
+            continue;
+        }
+        Engine::hge()->System_Log( "Reclaiming %s %s",
+                                   entity->getAllegianceName(),
+                                   entity->getTypeName() );
+
+        if ( entity->getType() == TYPE_CAR )
+        {
+            static_cast< Car * >( entity )->emptyContainer();
+        }
+        if ( entity->getContainer() != 0 )
+        {
+            entity->getContainer()->leave( entity );
+        }
+        std::vector< Entity * >::const_iterator i;
+        for ( i = entities.begin(); i != entities.end(); ++i )
+        {
+            if ( * i != 0 )
+            {
+                ( * i )->forgetEntity( entity );
+            }
+        }
+
+        m_cars.erase( std::remove( m_cars.begin(), m_cars.end(), entity ),
+                      m_cars.end() );
+        m_trees.erase( std::remove( m_trees.begin(), m_trees.end(), entity ),
+                       m_trees.end() );
+        m_guys.erase( std::remove( m_guys.begin(), m_guys.end(), entity ),
+                      m_guys.end() );
+        m_buildings.erase( std::remove( m_buildings.begin(),
+                                        m_buildings.end(), entity ),
+                           m_buildings.end() );
+        m_parked.erase( std::remove( m_parked.begin(), m_parked.end(),
+                                     entity ), m_parked.end() );
+        if ( entity->getType() == TYPE_GUY )
+        {
+            m_members.erase( static_cast< Guy * >( entity ) );
+        }
+        m_team.erase( std::remove( m_team.begin(), m_team.end(), entity ),
+                      m_team.end() );
+        m_squad.erase( std::remove( m_squad.begin(), m_squad.end(), entity ),
+                       m_squad.end() );
+        if ( m_locked == entity->getHandle() )
+        {
+            m_lock_camera = false;
+        }
+
+        // The cache can't put it back, so a replay would no longer match.
+        if ( m_replay->isRecording() )
+        {
+            m_replay->stop();
+        }
+
+        Engine::im()->remove( entity );
+        wc->release( entity );
+    }
+
+    if ( m_team.size() == 0 && m_squad.size() > 0 )
+    {
+        _select( m_squad.front(), false );
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_updateCars( float dt )
+{
+    std::vector< Car * >::iterator i;
+    for ( i = m_cars.begin(); i != m_cars.end();  ++i )
+    {
+        ( * i )->update( dt );
+        if ( ( * i )->isDestroyed() )
+        {
+            // TODO: eject occupants, explode, replace with charred body
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Those in view and closest to the middle of the screen are decided first.
+void
+Game::_updateGuys( float dt )
+{
+    b2AABB view;
+    Engine::vp()->getView( view );
+    b2Vec2 centre( 0.5f * ( view.lowerBound + view.upperBound ) );
+
+    std::vector< Guy * >::iterator i;
+    for ( i = m_guys.begin(); i != m_guys.end(); ++i )
+    {
+        ( * i )->update( dt );
+        if ( ( * i )->isDestroyed() )
+        {
+            // TODO: replace with crucifix
+        }
+        if ( ( * i )->needsDecision() )
+        {
+            b2Vec2 position( ( * i )->getBody()->GetPosition() );
+            float priority( ( position - centre ).Length() );
+            if ( ! m_visibility->isVisible( * i ) )
+            {
+                priority += HIDDEN_PRIORITY;
+            }
+            m_scheduler->request( * i, priority );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_updateBuildings( float dt )
+{
+    std::vector< Building * >::iterator i;
+    for ( i = m_buildings.begin(); i != m_buildings.end(); ++i )
+    {
+        ( * i )->update( dt );
+        if ( ( * i )->getMeta()->isDestroyed() &&
+             ( * i )->getMeta()->getOwner() == ( * i ) )
+        {
+            // TODO: eject occupants
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// The map is already drawn, so the ground is only a matter of putting down the
+// few tiles that can be seen.
+void
+Game::_renderGround( const b2AABB & view )
+{
+    float half( 0.5f * GROUND_SIZE );
+    float origin( -0.5f * GROUND_SIZE * ( GROUND_TILES - 1 ) );
+    for ( int y = 0; y < GROUND_TILES; ++y )
+    {
+        float cy( origin + y * GROUND_SIZE );
+        if ( cy + half < view.lowerBound.y || cy - half > view.upperBound.y )
+        {
+            continue;
+        }
+        for ( int x = 0; x < GROUND_TILES; ++x )
+        {
+            float cx( origin + x * GROUND_SIZE );
+            if ( cx + half < view.lowerBound.x ||
+                 cx - half > view.upperBound.x )
+            {
+                continue;
+            }
+            m_ground[y * GROUND_TILES + x]->Render( cx, cy );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// The shadows are four quarters of the map, stretched over it.
+void
+Game::_renderShadows( const b2AABB & view )
+{
+    float size( GROUND_SIZE * GROUND_TILES / SHADOW_TILES );
+    float half( 0.5f * size );
+    float origin( -0.5f * size * ( SHADOW_TILES - 1 ) );
+    for ( int y = 0; y < SHADOW_TILES; ++y )
+    {
+        float cy( origin + y * size );
+        for ( int x = 0; x < SHADOW_TILES; ++x )
+        {
+            float cx( origin + x * size );
+            if ( cx + half < view.lowerBound.x ||
+                 cx - half > view.upperBound.x ||
+                 cy + half < view.lowerBound.y ||
+                 cy - half > view.upperBound.y )
+            {
+                continue;
+            }
+            m_shadows[y * SHADOW_TILES + x]->RenderEx( cx, cy, 0.0f,
+                                                       SHADOW_SCALE,
+                                                       SHADOW_SCALE );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Buildings, trees and parked cars are part of the map, so only the cars and
+// the guys need drawing; there's no point walking past every static body to
+// find them.
+void
+Game::_renderBodies()
+{
+    std::vector< Car * >::iterator i;
+    for ( i = m_cars.begin(); i != m_cars.end(); ++i )
+    {
+        if ( m_visibility->isVisible( * i ) )
+        {
+            ( * i )->render();
+        }
+    }
+    std::vector< Guy * >::iterator j;
+    for ( j = m_guys.begin(); j != m_guys.end(); ++j )
+    {
+        if ( m_visibility->isVisible( * j ) )
+        {
+            ( * j )->render();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Labels only hang over cars, buildings and people, so those are all we walk,
+// and anything off screen is skipped before it's asked for a label. Fused
+// buildings share their owner's body, and the owner speaks for the block.
+void
+Game::_renderGuis()
+{
+    Entity * picked( Entity::lookup( m_picked ) );
+    b2AABB view;
+    Engine::vp()->getView( view );
+
+    // Zoomed right out only assets and the target are labelled, so it's only
+    // closer in, where everyone that's known gets a label, that they pile up.
+    m_labels->begin();
+    m_labels->setDeclutter( m_zoom > 1 );
+    std::vector< Car * >::iterator i;
+    for ( i = m_cars.begin(); i != m_cars.end(); ++i )
+    {
+        _renderLabel( * i, ( * i )->getAABB(), picked, view );
+    }
+    std::vector< Guy * >::iterator j;
+    for ( j = m_guys.begin(); j != m_guys.end(); ++j )
+    {
+        _renderLabel( * j, ( * j )->getAABB(), picked, view );
+    }
+    std::vector< Building * >::iterator k;
+    for ( k = m_buildings.begin(); k != m_buildings.end(); ++k )
+    {
+        if ( ( * k )->getBody()->GetUserData() == static_cast< void * >( * k ) )
+        {
+            _renderLabel( * k, ( * k )->getMeta()->getAABB(), picked, view );
+        }
+    }
+    m_labels->render( m_gui );
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_renderLabel( Entity * entity, const b2AABB & aabb, Entity * picked,
+                    const b2AABB & view )
+{
+    if ( entity != picked && ! m_visibility->isVisible( entity ) )
+    {
+        return;
+    }
+    if ( ! b2TestOverlap( aabb, view ) )
+    {
+        return;
+    }
+    entity->renderGui( m_labels, m_zoom, picked );
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_renderTarget( DWORD color, const b2AABB & aabb )
+{
+    ViewPort * vp( Engine::vp() );
+    float width( 7.0f / vp->hscale() );
+    float height( 7.0f / vp->vscale() );
+    float dx( 2.0f / vp->hscale() );
+    float dy( 2.0f / vp->vscale() );
+    m_gui->SetColor( color );
+    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.lowerBound.y - height,
+                          aabb.lowerBound.x, aabb.lowerBound.y - height + dy );
+    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.lowerBound.y - height,
+                          aabb.lowerBound.x - width + dx, aabb.lowerBound.y );
+    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.lowerBound.y - height,
+                          aabb.upperBound.x, aabb.lowerBound.y - height + dy );
+    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.lowerBound.y - height,
+                          aabb.upperBound.x + width - dx, aabb.lowerBound.y );
+    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.upperBound.y + height,
+                          aabb.upperBound.x, aabb.upperBound.y + height - dy );
+    m_gui->RenderStretch( aabb.upperBound.x + width, aabb.upperBound.y + height,
+                          aabb.upperBound.x + width - dx, aabb.upperBound.y );
+    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.upperBound.y + height,
+                          aabb.lowerBound.x, aabb.upperBound.y + height - dy );
+    m_gui->RenderStretch( aabb.lowerBound.x - width, aabb.upperBound.y + height,
+                          aabb.lowerBound.x - width + dx, aabb.upperBound.y );
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_renderGui()
+{
+    HGE * hge( Engine::hge() );
+    hgeResourceManager * rm( Engine::rm() );
+    float width =
+        static_cast< float >( hge->System_GetState( HGE_SCREENWIDTH ) );
+    float height =
+        static_cast< float >( hge->System_GetState( HGE_SCREENHEIGHT ) );
+    hgeFont * font( rm->GetFont( "dialogue" ) );
+    font->SetColor( 0xFFFFCCFF );
+    ViewPort * vp( Engine::vp() );
+    b2Vec2 mouse( 0.0f, 0.0f );
+    hge->Input_GetMousePos( & mouse.x, & mouse.y );
+    b2Vec2 point( mouse );
+    vp->screenToWorld( point );
+
+    if ( m_lock_camera )
+    {
+        font->printf( 10.0f, 10.0f, HGETEXT_LEFT, "CAMERA LOCKED" );
+    }
+
+    m_gui->SetColor( 0x88000000 );
+    m_gui->RenderStretch( 540.0f, 6.0f, 740.0f, 25.0f );
+
+    Entity * picked( Entity::lookup( m_picked ) );
+    if ( picked != 0 )
+    {
+        font->printf( 640.0f, 10.0f, HGETEXT_CENTER, "%s -> %s %s",
+                      ACTION_NAME[m_actionType],
+                      picked->getAllegianceName(),
+                      picked->getTypeName() );
+    }
+
+    if ( Engine::instance()->isDebug() )
+    {
+        font->printf( 10.0f, 30.0f, HGETEXT_LEFT,
+                      "AI: %d queued, %d decided, %.1fms wait (%.1fms worst)",
+                      m_scheduler->getDepth(), m_scheduler->getDecisions(),
+                      m_scheduler->getLatency(),
+                      m_scheduler->getWorstLatency() );
+        font->printf( 10.0f, 50.0f, HGETEXT_LEFT,
+                      "Influence: %d stamps moved",
+                      Engine::im()->getMoves() );
+    }
+
+    m_gui->RenderStretch( 300.0f, 776.0F, 980.0f, 795.0f );
+    for ( unsigned int i = 0; i < m_squad.size(); ++i )
+    {
+        if ( _isSelected( m_squad[i] ) )
+        {
+            font->printf( 390.0f + 160.0f * i, 780.0f, HGETEXT_CENTER,
+                          "[%s]", m_squad[i]->getName() );
+        }
+        else
+        {
+            font->printf( 390.0f + 160.0f * i, 780.0f, HGETEXT_CENTER,
+                          m_squad[i]->getName() );
+        }
+        font->printf( 310.0f + 160.0f * i, 780.0f, HGETEXT_CENTER, "|" );
+    }
+    font->printf( 960.0f, 780.0f, HGETEXT_CENTER, "|" );
+
+    if ( m_selecting )
+    {
+        const b2Vec2 & origin( m_mouse.getLeft().getOrigin() );
+        m_gui->SetColor( 0x2288FF88 );
+        m_gui->RenderStretch( origin.x, origin.y, mouse.x, mouse.y );
+        hge->Gfx_RenderLine( origin.x, origin.y, mouse.x, origin.y,
+                             0xCC88FF88 );
+        hge->Gfx_RenderLine( mouse.x, origin.y, mouse.x, mouse.y,
+                             0xCC88FF88 );
+        hge->Gfx_RenderLine( mouse.x, mouse.y, origin.x, mouse.y,
+                             0xCC88FF88 );
+        hge->Gfx_RenderLine( origin.x, mouse.y, origin.x, origin.y,
+                             0xCC88FF88 );
+    }
+
+    hge->Gfx_RenderLine( 0.0f, mouse.y, mouse.x - 5.0f, mouse.y, 0xCCFFFFFF );
+    hge->Gfx_RenderLine( mouse.x + 5.0f, mouse.y, 800.0f, mouse.y, 0xCCFFFFFF );
+    hge->Gfx_RenderLine( mouse.x, 0.0f, mouse.x, mouse.y - 5.0f, 0xCCFFFFFF );
+    hge->Gfx_RenderLine( mouse.x, mouse.y + 5.0f, mouse.x, 600.0f, 0xCCFFFFFF );
+    hge->Gfx_RenderLine( mouse.x - 6.0f, mouse.y - 10.0f,
+                         mouse.x + 6.0f, mouse.y - 10.0f, 0xEEFFFFFF ); 
+    hge->Gfx_RenderLine( mouse.x + 10.0f, mouse.y - 6.0f,
+                         mouse.x + 10.0f, mouse.y + 6.0f, 0xEEFFFFFF ); 
+    hge->Gfx_RenderLine( mouse.x + 6.0f, mouse.y + 10.0f,
+                         mouse.x - 6.0f, mouse.y + 10.0f, 0xEEFFFFFF ); 
+    hge->Gfx_RenderLine( mouse.x - 10.0f, mouse.y + 6.0f,
+                         mouse.x - 10.0f, mouse.y - 6.0f, 0xEEFFFFFF ); 
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_setViewport( Entity * entity )
+{
+    if ( entity == 0 || entity->getBody() == 0 )
+    {
+        return;
+    }
+    m_locked = entity->getHandle();
+    ViewPort * vp( Engine::vp() );
+    b2Vec2 position( entity->getBody()->GetPosition() );
+    b2Vec2 offset( -1.0f * position );
+    offset.x += 0.5f * vp->bounds().x * vp->hscale();
+    offset.y += 0.5f * vp->bounds().y * vp->vscale();
+    vp->setOffset( offset );
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_saveGame()
+{
+    m_autosave = 0.0f;
+    m_save->save( Engine::wc()->getEntities() );
+}
+
+//------------------------------------------------------------------------------
+void
+Game::_loadGame()
+{
+    if ( ! m_save->load( Engine::wc()->getEntities() ) )
+    {
+        return;
+    }
+    // The replay starts from the beginning of the mission, so it can't follow
+    // us into a saved game.
+    m_replay->stop();
+    m_autosave = 0.0f;
+    m_mouse.clear();
+}
+
+//------------------------------------------------------------------------------
+// Runs the recording from the start of the mission as fast as possible, with
+// nothing rendered, and reports whether the world came out the same. The world
+// ends up where it was, so recording carries on afterwards.
+void
+Game::_playReplay()
+{
+    if ( ! m_replay->isRecording() )
+    {
+        return;
+    }
+
+    HGE * hge( Engine::hge() );
+    b2World * b2d( Engine::b2d() );
+    WorldCache * wc( Engine::wc() );
+    const std::vector< Entity * > & entities( wc->getEntities() );
+    const std::vector< float > & deltas( m_replay->getDeltas() );
+    const std::vector< ReplayOrder > & orders( m_replay->getOrders() );
+    const std::vector< ReplayDecision > & decisions(
+        m_replay->getDecisions() );
+
+    m_save->flush();
+    m_replay->stop();
+    wc->restore();
+    Random::seed( m_replay->getSeed() );
+    if ( ! m_replay->checkStart( entities ) )
+    {
+        hge->System_Log( "Replay started from a different world" );
+    }
+
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER begin;
+    LARGE_INTEGER end;
+    QueryPerformanceFrequency( & frequency );
+    QueryPerformanceCounter( & begin );
+
+    unsigned int mismatches( 0 );
+    unsigned int next( 0 );
+    unsigned int decision( 0 );
+    for ( unsigned int tick = 0; tick < deltas.size(); ++tick )
+    {
+        b2d->Step( deltas[tick], 10 );
+        if ( ! m_replay->wasPaused( tick ) )
+        {
+            _simulate( deltas[tick] );
+        }
+        while ( decision < decisions.size() &&
+                decisions[decision].tick == tick )
+        {
+            Entity * entity( entities[decisions[decision++].entity] );
+            if ( entity != 0 )
+            {
+                static_cast< Guy * >( entity )->decide();
+            }
+        }
+        if ( ! m_replay->checkHash( tick, entities ) )
+        {
+            if ( mismatches == 0 )
+            {
+                hge->System_Log( "Replay diverged at tick %d", tick );
+            }
+            ++mismatches;
+        }
+        while ( next < orders.size() && orders[next].tick == tick )
+        {
+            const ReplayOrder & order( orders[next++] );
+            std::vector< Guy * > team;
+            std::vector< int >::const_iterator i;
+            for ( i = order.team.begin(); i != order.team.end(); ++i )
+            {
+                if ( entities[* i] != 0 )
+                {
+                    team.push_back( static_cast< Guy * >( entities[* i] ) );
+                }
+            }
+            Entity * target( order.target >= 0 ? entities[order.target] : 0 );
+            _giveOrder( order.action, target, order.point, team );
+        }
+    }
+
+    QueryPerformanceCounter( & end );
+    double seconds( static_cast< double >( end.QuadPart - begin.QuadPart ) /
+                    static_cast< double >( frequency.QuadPart ) );
+
+    hge->System_Log( "Replayed %d ticks in %.3fs (%.0f ticks/sec), %d diverged",
+                     deltas.size(), seconds,
+                     seconds > 0.0 ? deltas.size() / seconds : 0.0,
+                     mismatches );
+
+    m_replay->resume();
+}
+
+//------------------------------------------------------------------------------
+// Sends every guy in the world to a randomly chosen building a few times over,
+// which is about as busy as the streets get.
+void
+Game::_benchmarkNavigation()
+{
+    if ( m_buildings.size() == 0 )
+    {
+        return;
+    }
+
+    std::vector< b2Vec2 > starts;
+    std::vector< b2Vec2 > goals;
+    int last( static_cast< int >( m_buildings.size() ) - 1 );
+    for ( unsigned int round = 0; round < BENCHMARK_ROUNDS; ++round )
+    {
+        std::vector< Guy * >::iterator i;
+        for ( i = m_guys.begin(); i != m_guys.end(); ++i )
+        {
+            int j( Random::integer( ( * i )->getIndex(),
+                                    STREAM_BENCHMARK + round, 0, last ) );
+            starts.push_back( ( * i )->getBody()->GetPosition() );
+            goals.push_back( m_buildings[j]->getBody()->GetPosition() );
+        }
+    }
+
+    Engine::nav()->benchmark( starts, goals );
+}
+
+//------------------------------------------------------------------------------
+// Lets a crowd loose in the streets, first in a single world and then split
+// over a grid of worlds stepped on every processor, to see whether sharding
+// the physics would pay for itself.
+void
+Game::_benchmarkPhysics()
+{
+    HGE * hge( Engine::hge() );
+    NavGrid * nav( Engine::nav() );
+    b2AABB bounds;
+    bounds.lowerBound.Set( -2500.0f, -2500.0f );
+    bounds.upperBound.Set( 2500.0f, 2500.0f );
+
+    SYSTEM_INFO info;
+    GetSystemInfo( & info );
+    int threads( static_cast< int >( info.dwNumberOfProcessors ) );
+
+    std::vector< b2Vec2 > crowd;
+    int last( nav->getWidth() * nav->getHeight() - 1 );
+    for ( int key = 0; static_cast< int >( crowd.size() ) < CROWD_SIZE &&
+                       key < CROWD_SIZE * 4; ++key )
+    {
+        int cell( Random::integer( key, STREAM_CROWD, 0, last ) );
+        if ( ! nav->isBlocked( cell ) )
+        {
+            crowd.push_back( nav->centreOf( cell ) );
+        }
+    }
+
+    const int SHARDS[] = { 1, 2, 4 };
+    int count( static_cast< int >( crowd.size() ) );
+    for ( int i = 0; i < 3; ++i )
+    {
+        ShardedWorld world( bounds, SHARDS[i], SHARDS[i],
+                            i == 0 ? 0 : threads );
+        world.addStatic( Engine::b2d() );
+        if ( i == 0 )
+        {
+            count = std::min( count,
+                              b2_maxProxies - world.getProxyCount() - 1 );
+        }
+
+        for ( int j = 0; j < count; ++j )
+        {
+            b2BodyDef bodyDef;
+            bodyDef.position = crowd[j];
+            b2CircleDef shapeDef;
+            shapeDef.radius = 7.0f;
+            shapeDef.density = 0.1f;
+            Entity::filterShape( shapeDef, CATEGORY_HOSTILE );
+            int handle( world.addBody( bodyDef, shapeDef ) );
+            float angle( Random::range( j, STREAM_CROWD + 1, 0.0f,
+                                        2.0f * M_PI ) );
+            float speed( Random::range( j, STREAM_CROWD + 2, 20.0f, 60.0f ) );
+            world.getBody( handle )->SetLinearVelocity(
+                b2Vec2( speed * cosf( angle ), speed * sinf( angle ) ) );
+        }
+
+        LARGE_INTEGER frequency;
+        LARGE_INTEGER begin;
+        LARGE_INTEGER end;
+        QueryPerformanceFrequency( & frequency );
+        QueryPerformanceCounter( & begin );
+
+        int contacts( 0 );
+        std::vector< ShardedWorld::ShardContact > buffered;
+        for ( int step = 0; step < CROWD_STEPS; ++step )
+        {
+            world.step( 1.0f / 60.0f, 10 );
+            world.getContacts( buffered );
+            contacts += static_cast< int >( buffered.size() );
+        }
+
+        QueryPerformanceCounter( & end );
+        double seconds( static_cast< double >( end.QuadPart - begin.QuadPart ) /
+                        static_cast< double >( frequency.QuadPart ) );
+
+        hge->System_Log( "Stepped %d bodies in %d shards on %d threads: "
+                         "%.0f steps/sec, %d migrations, %d contacts",
+                         count, world.getNumShards(), world.getNumThreads(),
+                         seconds > 0.0 ? CROWD_STEPS / seconds : 0.0,
+                         world.getMigrations(), contacts );
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,97 @@
+//==============================================================================
+
+#include <handles.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const unsigned int SLOT_BITS( 20 );
+    const unsigned int SLOT_MASK( ( 1 << SLOT_BITS ) - 1 );
+    const unsigned int GENERATION_MASK( 0xFFFFFFFF >> SLOT_BITS );
+
+    inline EntityHandle
+    makeHandle( unsigned int slot, unsigned int generation )
+    {
+        return generation << SLOT_BITS | slot;
+    }
+};
+
+//------------------------------------------------------------------------------
+HandleTable::HandleTable()
+    :
+    m_slots(),
+    m_free()
+{
+}
+
+//------------------------------------------------------------------------------
+HandleTable::~HandleTable()
+{
+}
+
+//------------------------------------------------------------------------------
+EntityHandle
+HandleTable::add( Entity * entity )
+{
+    unsigned int slot( 0 );
+    if ( m_free.size() > 0 )
+    {
+        slot = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        Slot fresh;
+        fresh.entity = 0;
+        fresh.generation = 1;
+        slot = static_cast< unsigned int >( m_slots.size() );
+        m_slots.push_back( fresh );
+    }
+
+    m_slots[slot].entity = entity;
+    return makeHandle( slot, m_slots[slot].generation );
+}
+
+//------------------------------------------------------------------------------
+// The slot's generation moves on so that old handles no longer match it.
+void
+HandleTable::remove( EntityHandle handle )
+{
+    if ( ! isValid( handle ) )
+    {
+        return;
+    }
+    unsigned int slot( handle & SLOT_MASK );
+    m_slots[slot].entity = 0;
+    m_slots[slot].generation = ( m_slots[slot].generation + 1 ) &
+                               GENERATION_MASK;
+    if ( m_slots[slot].generation == 0 )
+    {
+        m_slots[slot].generation = 1;
+    }
+    m_free.push_back( slot );
+}
+
+//------------------------------------------------------------------------------
+Entity *
+HandleTable::lookup( EntityHandle handle )
+{
+    if ( ! isValid( handle ) )
+    {
+        return 0;
+    }
+    return m_slots[handle & SLOT_MASK].entity;
+}
+
+//------------------------------------------------------------------------------
+bool
+HandleTable::isValid( EntityHandle handle )
+{
+    unsigned int slot( handle & SLOT_MASK );
+    return handle != 0 && slot < m_slots.size() &&
+           m_slots[slot].entity != 0 &&
+           m_slots[slot].generation == handle >> SLOT_BITS;
+}
+
+//==============================================================================
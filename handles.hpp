@@ -0,0 +1,50 @@
+//==============================================================================
+
+#ifndef ArseHandles
+#define ArseHandles
+
+#include <vector>
+
+class Entity;
+
+//------------------------------------------------------------------------------
+// A handle names an entity without pointing at it. The low bits pick a slot in
+// the table and the high bits hold the generation of that slot, which moves on
+// whenever its entity is deleted, so a handle that outlives its entity simply
+// stops resolving. Zero is never handed out and always means nobody.
+typedef unsigned int EntityHandle;
+
+//------------------------------------------------------------------------------
+// Every entity takes a slot when it's made and gives it back when it's deleted.
+// Slots are recycled through a free list, so the table never grows beyond the
+// most entities that have been alive at once.
+class HandleTable
+{
+  public:
+    HandleTable();
+    ~HandleTable();
+
+  private:
+    HandleTable( const HandleTable & );
+    HandleTable & operator=( const HandleTable & );
+
+    struct Slot
+    {
+        Entity * entity;
+        unsigned int generation;
+    };
+
+  public:
+    EntityHandle add( Entity * entity );
+    void remove( EntityHandle handle );
+    Entity * lookup( EntityHandle handle );
+    bool isValid( EntityHandle handle );
+
+  private:
+    std::vector< Slot > m_slots;
+    std::vector< unsigned int > m_free;
+};
+
+#endif
+
+//==============================================================================
@@ -0,0 +1,216 @@
+//==============================================================================
+
+#include <cmath>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <influence.hpp>
+#include <entity.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const float WORLD_MIN( -2500.0f );
+    const float CELL_SIZE( 40.0f );
+    const int GRID_WIDTH( 125 );
+    const int GRID_HEIGHT( 125 );
+    const int STAMP_RADIUS( 4 );
+};
+
+//------------------------------------------------------------------------------
+// The stamp is worked out once: its weight falls away by one for every cell
+// from the middle.
+InfluenceMap::InfluenceMap()
+    :
+    m_grid( GRID_WIDTH * GRID_HEIGHT * INFLUENCE_LAYERS, 0 ),
+    m_units(),
+    m_kernel(),
+    m_moves( 0 )
+{
+    for ( int dy = -STAMP_RADIUS; dy <= STAMP_RADIUS; ++dy )
+    {
+        for ( int dx = -STAMP_RADIUS; dx <= STAMP_RADIUS; ++dx )
+        {
+            float distance(
+                sqrtf( static_cast< float >( dx * dx + dy * dy ) ) );
+            Stamp stamp;
+            stamp.dx = dx;
+            stamp.dy = dy;
+            stamp.weight = STAMP_RADIUS + 1 -
+                           static_cast< int >( distance + 0.5f );
+            if ( stamp.weight > 0 )
+            {
+                m_kernel.push_back( stamp );
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+InfluenceMap::~InfluenceMap()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+InfluenceMap::clear()
+{
+    m_grid.assign( m_grid.size(), 0 );
+    m_units.clear();
+    m_moves = 0;
+}
+
+//------------------------------------------------------------------------------
+void
+InfluenceMap::update( const std::vector< Entity * > & entities )
+{
+    Unit nobody;
+    nobody.cell = -1;
+    nobody.layer = -1;
+    m_units.resize( entities.size(), nobody );
+    m_moves = 0;
+
+    for ( unsigned int i = 0; i < entities.size(); ++i )
+    {
+        Entity * entity( entities[i] );
+        int layer( entity != 0 ? _layerOf( entity ) : -1 );
+        int cell( -1 );
+        if ( layer >= 0 )
+        {
+            cell = cellAt( entity->getBody()->GetPosition() );
+        }
+        if ( cell < 0 )
+        {
+            layer = -1;
+        }
+
+        Unit & unit( m_units[i] );
+        if ( unit.cell == cell && unit.layer == layer )
+        {
+            continue;
+        }
+        if ( unit.cell >= 0 )
+        {
+            _stamp( unit.cell, unit.layer, -1 );
+        }
+        if ( cell >= 0 )
+        {
+            _stamp( cell, layer, 1 );
+        }
+        unit.cell = cell;
+        unit.layer = layer;
+        m_moves += 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Takes back the entity's stamp. Its unit stays behind, empty, just as its
+// slot does in the world cache.
+void
+InfluenceMap::remove( Entity * entity )
+{
+    int index( entity->getIndex() );
+    if ( index < 0 || index >= static_cast< int >( m_units.size() ) )
+    {
+        return;
+    }
+    Unit & unit( m_units[index] );
+    if ( unit.cell >= 0 )
+    {
+        _stamp( unit.cell, unit.layer, -1 );
+    }
+    unit.cell = -1;
+    unit.layer = -1;
+}
+
+//------------------------------------------------------------------------------
+int
+InfluenceMap::sample( InfluenceLayer layer, const b2Vec2 & point )
+{
+    int cell( cellAt( point ) );
+    if ( cell < 0 )
+    {
+        return 0;
+    }
+    return m_grid[cell * INFLUENCE_LAYERS + layer];
+}
+
+//------------------------------------------------------------------------------
+int
+InfluenceMap::cellAt( const b2Vec2 & point )
+{
+    int x( static_cast< int >(
+        floorf( ( point.x - WORLD_MIN ) / CELL_SIZE ) ) );
+    int y( static_cast< int >(
+        floorf( ( point.y - WORLD_MIN ) / CELL_SIZE ) ) );
+    if ( x < 0 || y < 0 || x >= GRID_WIDTH || y >= GRID_HEIGHT )
+    {
+        return -1;
+    }
+    return y * GRID_WIDTH + x;
+}
+
+//------------------------------------------------------------------------------
+// How many stamps were moved by the last update.
+int
+InfluenceMap::getMoves()
+{
+    return m_moves;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+// Only people who are out on the street count, on the side they're seen to be
+// on, so anyone not yet identified counts as a civilian.
+int
+InfluenceMap::_layerOf( Entity * entity )
+{
+    if ( entity->getType() != TYPE_GUY || entity->getContainer() != 0 )
+    {
+        return -1;
+    }
+    if ( static_cast< Guy * >( entity )->isDestroyed() )
+    {
+        return -1;
+    }
+    switch ( entity->getAllegiance() )
+    {
+        case ALLEGIANCE_ASSET:
+        {
+            return INFLUENCE_SQUAD;
+        }
+        case ALLEGIANCE_HOSTILE:
+        {
+            return INFLUENCE_HOSTILE;
+        }
+        default:
+        {
+            return INFLUENCE_CIVILIAN;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+InfluenceMap::_stamp( int cell, int layer, int sign )
+{
+    int cx( cell % GRID_WIDTH );
+    int cy( cell / GRID_WIDTH );
+    std::vector< Stamp >::const_iterator i;
+    for ( i = m_kernel.begin(); i != m_kernel.end(); ++i )
+    {
+        int x( cx + i->dx );
+        int y( cy + i->dy );
+        if ( x < 0 || y < 0 || x >= GRID_WIDTH || y >= GRID_HEIGHT )
+        {
+            continue;
+        }
+        m_grid[( y * GRID_WIDTH + x ) * INFLUENCE_LAYERS + layer] +=
+            sign * i->weight;
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,76 @@
+//==============================================================================
+
+#ifndef ArseInfluence
+#define ArseInfluence
+
+#include <vector>
+
+#include <Box2D.h>
+
+class Entity;
+
+//------------------------------------------------------------------------------
+enum InfluenceLayer
+{
+    INFLUENCE_SQUAD = 0,
+    INFLUENCE_HOSTILE = 1,
+    INFLUENCE_CIVILIAN = 2,
+    INFLUENCE_LAYERS = 3
+};
+
+//------------------------------------------------------------------------------
+// Who holds sway where. Every person on the street stamps a small cone of
+// influence onto a coarse grid, in the layer for their side, and the stamps
+// simply add up. A stamp is only taken back and put down again when its owner
+// crosses into another cell, changes sides or goes indoors, so most people
+// cost nothing from one frame to the next, and asking how much influence a
+// side has somewhere is a single lookup. Weights are whole numbers, so taking
+// a stamp back always leaves exactly what was there before.
+//
+// Units are indexed the same way as the world cache, and have to be removed
+// here before the cache lets go of them.
+class InfluenceMap
+{
+  public:
+    InfluenceMap();
+    ~InfluenceMap();
+
+  private:
+    InfluenceMap( const InfluenceMap & );
+    InfluenceMap & operator=( const InfluenceMap & );
+
+    struct Unit
+    {
+        int cell;
+        int layer;
+    };
+
+    struct Stamp
+    {
+        int dx;
+        int dy;
+        int weight;
+    };
+
+  public:
+    void clear();
+    void update( const std::vector< Entity * > & entities );
+    void remove( Entity * entity );
+    int sample( InfluenceLayer layer, const b2Vec2 & point );
+    int cellAt( const b2Vec2 & point );
+    int getMoves();
+
+  private:
+    int _layerOf( Entity * entity );
+    void _stamp( int cell, int layer, int sign );
+
+  private:
+    std::vector< int > m_grid;
+    std::vector< Unit > m_units;
+    std::vector< Stamp > m_kernel;
+    int m_moves;
+};
+
+#endif
+
+//==============================================================================
@@ -0,0 +1,388 @@
+//==============================================================================
+
+#include <cstdio>
+
+#include <hgefont.h>
+#include <hgesprite.h>
+
+#include <engine.hpp>
+#include <entity.hpp>
+#include <viewport.hpp>
+#include <labels.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const DWORD BACKGROUND_COLOUR( 0x44000000 );
+    const float LINE_SPACING( 15.0f );
+    const float LABEL_OFFSET( 30.0f );
+    const unsigned int PRUNE_INTERVAL( 300 );
+    const float BIN_WIDTH( 120.0f );
+    const float BIN_HEIGHT( 40.0f );
+    const unsigned int MAX_DRAWS( 48 );
+};
+
+//------------------------------------------------------------------------------
+// Every glyph of a bitmap font lives on the same texture, so the first glyph
+// we find tells us what to batch with.
+Labels::Labels( hgeFont * font )
+    :
+    m_font( font ),
+    m_texture( 0 ),
+    m_blend( BLEND_DEFAULT ),
+    m_width( 1.0f ),
+    m_height( 1.0f ),
+    m_frame( 0 ),
+    m_declutter( false ),
+    m_labels(),
+    m_aggregates(),
+    m_names(),
+    m_queue()
+{
+    HGE * hge( Engine::hge() );
+    for ( int i = 32; i < 128; ++i )
+    {
+        hgeSprite * sprite( m_font->GetSprite( static_cast< char >( i ) ) );
+        if ( sprite != 0 )
+        {
+            m_texture = sprite->GetTexture();
+            m_blend = sprite->GetBlendMode();
+            m_width =
+                static_cast< float >( hge->Texture_GetWidth( m_texture ) );
+            m_height =
+                static_cast< float >( hge->Texture_GetHeight( m_texture ) );
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+Labels::~Labels()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+Labels::begin()
+{
+    m_queue.clear();
+    m_frame += 1;
+    if ( m_frame % PRUNE_INTERVAL == 0 )
+    {
+        _prune();
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+Labels::setDeclutter( bool declutter )
+{
+    m_declutter = declutter;
+}
+
+//------------------------------------------------------------------------------
+// What an aggregate of the group calls itself, as in "12 unknown".
+void
+Labels::setGroupName( int group, const char * name )
+{
+    m_names[group] = name;
+}
+
+//------------------------------------------------------------------------------
+bool
+Labels::isCurrent( EntityHandle handle, unsigned int state )
+{
+    std::map< EntityHandle, Label >::iterator i( m_labels.find( handle ) );
+    return i != m_labels.end() && i->second.state == state;
+}
+
+//------------------------------------------------------------------------------
+// Lays out a title and an optional second line beneath it, centred on the
+// anchor, in unscaled font pixels.
+void
+Labels::layout( EntityHandle handle, unsigned int state, int group,
+                DWORD colour, const char * title, const char * detail )
+{
+    Label & label( m_labels[handle] );
+    label.state = state;
+    label.group = group;
+    label.colour = colour;
+    label.frame = m_frame;
+    label.width = m_font->GetStringWidth( title, false ) + 2.0f;
+    label.glyphs.clear();
+    _layoutLine( title, colour, label.glyphs );
+    label.split = static_cast< unsigned int >( label.glyphs.size() );
+    if ( detail != 0 )
+    {
+        _layoutLine( detail, colour, label.glyphs );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Queues the label for drawing over an entity whose box starts at the given
+// point; the label sits a fixed distance above it on the screen.
+void
+Labels::add( EntityHandle handle, const b2Vec2 & position )
+{
+    std::map< EntityHandle, Label >::iterator i( m_labels.find( handle ) );
+    if ( i == m_labels.end() )
+    {
+        return;
+    }
+    i->second.frame = m_frame;
+    Placed placed;
+    placed.label = & i->second;
+    placed.position.Set( position.x,
+                         position.y - LABEL_OFFSET / Engine::vp()->vscale() );
+    m_queue.push_back( placed );
+}
+
+//------------------------------------------------------------------------------
+// Text is scaled the same both ways, by the horizontal zoom, as the font would
+// have done; the backgrounds and line spacing follow the vertical zoom.
+void
+Labels::render( hgeSprite * gui )
+{
+    HGE * hge( Engine::hge() );
+    ViewPort * vp( Engine::vp() );
+    float hscale( 1.0f / vp->hscale() );
+    float vscale( 1.0f / vp->vscale() );
+    float height( ( m_font->GetHeight() + 2.0f ) * vscale );
+
+    if ( m_declutter )
+    {
+        _declutter();
+    }
+
+    gui->SetColor( BACKGROUND_COLOUR );
+    std::vector< Placed >::iterator i;
+    for ( i = m_queue.begin(); i != m_queue.end(); ++i )
+    {
+        float width( i->label->width * hscale );
+        gui->RenderStretch( i->position.x - 0.5f * width,
+                            i->position.y - vscale,
+                            i->position.x + 0.5f * width,
+                            i->position.y + height );
+    }
+
+    if ( m_texture == 0 || m_queue.size() == 0 )
+    {
+        return;
+    }
+    int max( 0 );
+    hgeVertex * batch( hge->Gfx_StartBatch( HGEPRIM_QUADS, m_texture, m_blend,
+                                            & max ) );
+    int count( 0 );
+    for ( i = m_queue.begin(); i != m_queue.end() && batch != 0; ++i )
+    {
+        const std::vector< hgeVertex > & glyphs( i->label->glyphs );
+        for ( unsigned int j = 0; j < glyphs.size(); ++j )
+        {
+            if ( j % 4 == 0 && count == max )
+            {
+                hge->Gfx_FinishBatch( count );
+                batch = hge->Gfx_StartBatch( HGEPRIM_QUADS, m_texture,
+                                             m_blend, & max );
+                count = 0;
+                if ( batch == 0 )
+                {
+                    break;
+                }
+            }
+            float line( j < i->label->split ? 0.0f : LINE_SPACING * vscale );
+            hgeVertex & vertex( batch[count * 4 + j % 4] );
+            vertex = glyphs[j];
+            vertex.x = i->position.x + glyphs[j].x * hscale;
+            vertex.y = i->position.y + line + glyphs[j].y * hscale;
+            if ( j % 4 == 3 )
+            {
+                count += 1;
+            }
+        }
+    }
+    if ( batch != 0 )
+    {
+        hge->Gfx_FinishBatch( count );
+    }
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+// The same walk along the string that the font makes when it prints, except
+// that each glyph becomes a quad instead of being drawn.
+void
+Labels::_layoutLine( const char * text, DWORD colour,
+                     std::vector< hgeVertex > & glyphs )
+{
+    float x( -0.5f * m_font->GetStringWidth( text, false ) );
+    for ( const char * c = text; * c != '\0'; ++c )
+    {
+        hgeSprite * sprite( m_font->GetSprite( * c ) );
+        if ( sprite == 0 )
+        {
+            continue;
+        }
+        x += m_font->GetPreWidth( * c );
+
+        float tx( 0.0f );
+        float ty( 0.0f );
+        float tw( 0.0f );
+        float th( 0.0f );
+        sprite->GetTextureRect( & tx, & ty, & tw, & th );
+        float w( sprite->GetWidth() );
+        float h( sprite->GetHeight() );
+
+        hgeVertex corner;
+        corner.z = 0.5f;
+        corner.col = colour;
+        for ( int k = 0; k < 4; ++k )
+        {
+            bool right( k == 1 || k == 2 );
+            bool bottom( k >= 2 );
+            corner.x = right ? x + w : x;
+            corner.y = bottom ? h : 0.0f;
+            corner.tx = ( right ? tx + tw : tx ) / m_width;
+            corner.ty = ( bottom ? ty + th : ty ) / m_height;
+            glyphs.push_back( corner );
+        }
+
+        x += w + m_font->GetPostWidth( * c ) + m_font->GetTracking();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Bins the queued labels by where they fall on the screen and replaces every
+// bin holding more than one label of a group with a single count, centred on
+// them. Labels that mustn't be merged go first, so that they're never the ones
+// dropped when there are too many to draw.
+void
+Labels::_declutter()
+{
+    float hscale( Engine::vp()->hscale() );
+    float vscale( Engine::vp()->vscale() );
+    std::vector< Placed > drawn;
+    std::map< unsigned long long, Bin > bins;
+
+    std::vector< Placed >::iterator i;
+    for ( i = m_queue.begin(); i != m_queue.end(); ++i )
+    {
+        if ( i->label->group < 0 )
+        {
+            drawn.push_back( * i );
+            continue;
+        }
+        int x( static_cast< int >( floorf( i->position.x * hscale /
+                                           BIN_WIDTH ) ) );
+        int y( static_cast< int >( floorf( i->position.y * vscale /
+                                           BIN_HEIGHT ) ) );
+        unsigned long long key(
+            static_cast< unsigned long long >( x & 0xFFFFFF ) << 40 |
+            static_cast< unsigned long long >( y & 0xFFFFFF ) << 16 |
+            static_cast< unsigned long long >( i->label->group & 0xFFFF ) );
+        std::map< unsigned long long, Bin >::iterator j( bins.find( key ) );
+        if ( j == bins.end() )
+        {
+            Bin bin;
+            bin.count = 1;
+            bin.total = i->position;
+            bin.first = * i;
+            bins.insert( std::make_pair( key, bin ) );
+        }
+        else
+        {
+            j->second.count += 1;
+            j->second.total += i->position;
+        }
+    }
+
+    std::map< unsigned long long, Bin >::iterator j;
+    for ( j = bins.begin(); j != bins.end() && drawn.size() < MAX_DRAWS; ++j )
+    {
+        Bin & bin( j->second );
+        if ( bin.count == 1 )
+        {
+            drawn.push_back( bin.first );
+            continue;
+        }
+        Placed placed;
+        placed.label = _aggregate( bin.first.label->group, bin.count,
+                                   bin.first.label->colour );
+        placed.position = ( 1.0f / bin.count ) * bin.total;
+        drawn.push_back( placed );
+    }
+
+    if ( drawn.size() > MAX_DRAWS )
+    {
+        drawn.resize( MAX_DRAWS );
+    }
+    m_queue.swap( drawn );
+}
+
+//------------------------------------------------------------------------------
+// Counts are laid out like any other label, and kept for the next time that
+// the same number of the same group turn up together.
+Labels::Label *
+Labels::_aggregate( int group, int count, DWORD colour )
+{
+    unsigned int key( static_cast< unsigned int >( group ) << 16 |
+                      static_cast< unsigned int >( count & 0xFFFF ) );
+    std::map< unsigned int, Label >::iterator i( m_aggregates.find( key ) );
+    if ( i != m_aggregates.end() && i->second.colour == colour )
+    {
+        i->second.frame = m_frame;
+        return & i->second;
+    }
+
+    std::map< int, const char * >::iterator j( m_names.find( group ) );
+    char message[64];
+    sprintf_s( message, 63, "[%d %s]", count,
+               j != m_names.end() ? j->second : "more" );
+
+    Label & label( m_aggregates[key] );
+    label.state = 0;
+    label.group = group;
+    label.colour = colour;
+    label.frame = m_frame;
+    label.width = m_font->GetStringWidth( message, false ) + 2.0f;
+    label.glyphs.clear();
+    _layoutLine( message, colour, label.glyphs );
+    label.split = static_cast< unsigned int >( label.glyphs.size() );
+    return & label;
+}
+
+//------------------------------------------------------------------------------
+// Drops the layouts of entities that have been deleted or haven't been in view
+// for a while.
+void
+Labels::_prune()
+{
+    std::map< EntityHandle, Label >::iterator i;
+    for ( i = m_labels.begin(); i != m_labels.end(); )
+    {
+        if ( Entity::lookup( i->first ) == 0 ||
+             m_frame - i->second.frame > PRUNE_INTERVAL )
+        {
+            m_labels.erase( i++ );
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    std::map< unsigned int, Label >::iterator j;
+    for ( j = m_aggregates.begin(); j != m_aggregates.end(); )
+    {
+        if ( m_frame - j->second.frame > PRUNE_INTERVAL )
+        {
+            m_aggregates.erase( j++ );
+        }
+        else
+        {
+            ++j;
+        }
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,96 @@
+//==============================================================================
+
+#ifndef ArseLabels
+#define ArseLabels
+
+#include <vector>
+#include <map>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <handles.hpp>
+
+class hgeFont;
+class hgeSprite;
+
+//------------------------------------------------------------------------------
+// The labels that hang over entities. Each entity's text is laid out once into
+// glyph quads and measured, and is kept until the state that the entity says
+// its label depends on has changed. Every frame the labels in view are queued
+// and then drawn together: all of the backgrounds first, and then every glyph
+// in a single batch, so that the font texture is only set once.
+//
+// In a crowded part of the city there can be dozens of labels on screen, so
+// they can be decluttered: labels are binned into cells of screen space, and a
+// cell with several labels from the same group shows a count of them instead.
+// Labels in a negative group, such as the one on the picked entity, are never
+// merged, and only so many labels are drawn in a frame.
+class Labels
+{
+  public:
+    Labels( hgeFont * font );
+    ~Labels();
+
+  private:
+    Labels( const Labels & );
+    Labels & operator=( const Labels & );
+
+    struct Label
+    {
+        unsigned int state;
+        int group;
+        DWORD colour;
+        unsigned int frame;
+        float width;
+        unsigned int split;
+        std::vector< hgeVertex > glyphs;
+    };
+
+    struct Placed
+    {
+        Label * label;
+        b2Vec2 position;
+    };
+
+    struct Bin
+    {
+        int count;
+        b2Vec2 total;
+        Placed first;
+    };
+
+  public:
+    void begin();
+    void setDeclutter( bool declutter );
+    void setGroupName( int group, const char * name );
+    bool isCurrent( EntityHandle handle, unsigned int state );
+    void layout( EntityHandle handle, unsigned int state, int group,
+                 DWORD colour, const char * title, const char * detail );
+    void add( EntityHandle handle, const b2Vec2 & position );
+    void render( hgeSprite * gui );
+
+  private:
+    void _layoutLine( const char * text, DWORD colour,
+                      std::vector< hgeVertex > & glyphs );
+    void _declutter();
+    Label * _aggregate( int group, int count, DWORD colour );
+    void _prune();
+
+  private:
+    hgeFont * m_font;
+    HTEXTURE m_texture;
+    int m_blend;
+    float m_width;
+    float m_height;
+    unsigned int m_frame;
+    bool m_declutter;
+    std::map< EntityHandle, Label > m_labels;
+    std::map< unsigned int, Label > m_aggregates;
+    std::map< int, const char * > m_names;
+    std::vector< Placed > m_queue;
+};
+
+#endif
+
+//==============================================================================
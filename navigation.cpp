@@ -0,0 +1,1199 @@
+//==============================================================================
+
+#include <algorithm>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <engine.hpp>
+#include <navigation.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const float WORLD_MIN( -2500.0f );
+    const float CELL_SIZE( 10.0f );
+    const int GRID_WIDTH( 500 );
+    const int GRID_HEIGHT( 500 );
+    const float DIAGONAL( 1.41421356f );
+    const unsigned int CACHE_SIZE( 512 );
+    const int SNAP_RADIUS( 8 );
+    const unsigned int FLOW_CACHE_SIZE( 16 );
+    const int FLOW_LOOKAHEAD( 4 );
+    const unsigned char FLOW_GOAL( 254 );
+    const unsigned char FLOW_NONE( 255 );
+    const unsigned long long KEY_BUILDING( 1ULL << 32 );
+    const unsigned long long KEY_POINT( 2ULL << 32 );
+    const int CLUSTER_SIZE( 25 );
+    const int CLUSTERS_X( GRID_WIDTH / CLUSTER_SIZE );
+    const int CLUSTERS_Y( GRID_HEIGHT / CLUSTER_SIZE );
+    const int LONG_ENTRANCE( 6 );
+    const float UNREACHABLE( 1.0e30f );
+
+    // Straight moves first, then diagonals, in opposing pairs.
+    const int DX[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+    const int DY[8] = { 0, 0, 1, -1, 1, -1, -1, 1 };
+
+    inline float
+    octile( int from, int to )
+    {
+        int dx( abs( from % GRID_WIDTH - to % GRID_WIDTH ) );
+        int dy( abs( from / GRID_WIDTH - to / GRID_WIDTH ) );
+        int lo( dx < dy ? dx : dy );
+        int hi( dx < dy ? dy : dx );
+        return static_cast< float >( hi - lo ) +
+               DIAGONAL * static_cast< float >( lo );
+    }
+};
+
+//------------------------------------------------------------------------------
+bool
+NavGrid::OpenNode::operator<( const OpenNode & other ) const
+{
+    // Reversed, so that the standard heap functions give a min-heap.
+    return cost > other.cost;
+}
+
+//------------------------------------------------------------------------------
+NavGrid::NavGrid()
+    :
+    m_version( 0 ),
+    m_blocked( GRID_WIDTH * GRID_HEIGHT, 0 ),
+    m_cost( GRID_WIDTH * GRID_HEIGHT, 0.0f ),
+    m_parent( GRID_WIDTH * GRID_HEIGHT, -1 ),
+    m_stamp( GRID_WIDTH * GRID_HEIGHT, 0 ),
+    m_generation( 1 ),
+    m_open(),
+    m_lru(),
+    m_cache(),
+    m_hits( 0 ),
+    m_misses( 0 ),
+    m_flows(),
+    m_fields(),
+    m_users(),
+    m_clusters()
+{
+}
+
+//------------------------------------------------------------------------------
+NavGrid::~NavGrid()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+NavGrid::bake( b2World * world )
+{
+    clear();
+
+    for ( b2Body * body = world->GetBodyList(); body != 0;
+          body = body->GetNext() )
+    {
+        if ( ! body->IsStatic() || body->GetUserData() == 0 )
+        {
+            continue;
+        }
+        for ( b2Shape * shape = body->GetShapeList(); shape != 0;
+              shape = shape->GetNext() )
+        {
+            _rasterise( shape, body->GetXForm() );
+        }
+    }
+
+    m_clusters.resize( CLUSTERS_X * CLUSTERS_Y );
+    for ( int i = 0; i < CLUSTERS_X * CLUSTERS_Y; ++i )
+    {
+        _buildCluster( i );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Brings the grid up to date after static bodies have been added or removed
+// within the given area, rebuilding only the clusters that it touches. Cached
+// paths and flow fields could pass through the area, so they're all dropped.
+void
+NavGrid::rebuild( b2World * world, const b2AABB & area )
+{
+    if ( m_clusters.size() == 0 )
+    {
+        return;
+    }
+
+    b2Vec2 margin( CELL_SIZE, CELL_SIZE );
+    int lower( cellAt( area.lowerBound - margin ) );
+    int upper( cellAt( area.upperBound + margin ) );
+    int x0( lower >= 0 ? lower % GRID_WIDTH : 0 );
+    int y0( lower >= 0 ? lower / GRID_WIDTH : 0 );
+    int x1( upper >= 0 ? upper % GRID_WIDTH : GRID_WIDTH - 1 );
+    int y1( upper >= 0 ? upper / GRID_WIDTH : GRID_HEIGHT - 1 );
+
+    for ( int y = y0; y <= y1; ++y )
+    {
+        for ( int x = x0; x <= x1; ++x )
+        {
+            m_blocked[y * GRID_WIDTH + x] = 0;
+        }
+    }
+
+    b2AABB bounds;
+    bounds.lowerBound = centreOf( y0 * GRID_WIDTH + x0 ) - margin;
+    bounds.upperBound = centreOf( y1 * GRID_WIDTH + x1 ) + margin;
+    b2Shape * shapes[256];
+    int num( world->Query( bounds, shapes, 256 ) );
+    if ( num == 256 )
+    {
+        Engine::hge()->System_Log( "Too many shapes to rebuild navigation!" );
+    }
+    for ( int i = 0; i < num; ++i )
+    {
+        b2Body * body( shapes[i]->GetBody() );
+        if ( body->IsStatic() && body->GetUserData() != 0 )
+        {
+            _rasterise( shapes[i], body->GetXForm() );
+        }
+    }
+
+    // A change on the edge of a cluster moves the entrances of its neighbour,
+    // so the neighbours are rebuilt too.
+    int cx0( max( 0, ( x0 - 1 ) / CLUSTER_SIZE ) );
+    int cy0( max( 0, ( y0 - 1 ) / CLUSTER_SIZE ) );
+    int cx1( min( CLUSTERS_X - 1, ( x1 + 1 ) / CLUSTER_SIZE ) );
+    int cy1( min( CLUSTERS_Y - 1, ( y1 + 1 ) / CLUSTER_SIZE ) );
+    for ( int cy = cy0; cy <= cy1; ++cy )
+    {
+        for ( int cx = cx0; cx <= cx1; ++cx )
+        {
+            _buildCluster( cy * CLUSTERS_X + cx );
+        }
+    }
+
+    m_lru.clear();
+    m_cache.clear();
+    m_flows.clear();
+    m_fields.clear();
+    m_version += 1;
+}
+
+//------------------------------------------------------------------------------
+void
+NavGrid::clear()
+{
+    std::fill( m_blocked.begin(), m_blocked.end(), 0 );
+    m_lru.clear();
+    m_cache.clear();
+    m_flows.clear();
+    m_fields.clear();
+    m_clusters.clear();
+    m_version += 1;
+}
+
+//------------------------------------------------------------------------------
+// Changes every time the grid does, so that anything derived from it can tell
+// when it has gone stale.
+unsigned int
+NavGrid::getVersion()
+{
+    return m_version;
+}
+
+//------------------------------------------------------------------------------
+// Fills path with the waypoints from one point to another, not including the
+// starting point. A goal that lies inside an obstacle is moved to the nearest
+// free cell, which then becomes the last waypoint.
+bool
+NavGrid::findPath( const b2Vec2 & from, const b2Vec2 & to,
+                   std::vector< b2Vec2 > & path )
+{
+    path.clear();
+
+    int start( nearestFree( cellAt( from ) ) );
+    int goal( cellAt( to ) );
+    bool snapped( goal >= 0 && isBlocked( goal ) );
+    goal = nearestFree( goal );
+    if ( start < 0 || goal < 0 )
+    {
+        return false;
+    }
+
+    unsigned long long key( static_cast< unsigned long long >( start ) << 32 |
+                            static_cast< unsigned int >( goal ) );
+    const std::vector< int > * cells( _lookup( key ) );
+    if ( cells == 0 )
+    {
+        std::vector< int > found;
+        std::vector< int > corners;
+        if ( _search( start, goal, found ) )
+        {
+            _smooth( found, corners );
+        }
+        _remember( key, corners );
+        cells = & m_lru.front().cells;
+    }
+
+    if ( cells->size() == 0 )
+    {
+        return false;
+    }
+
+    for ( unsigned int i = 1; i < cells->size(); ++i )
+    {
+        path.push_back( centreOf( ( * cells )[i] ) );
+    }
+    if ( snapped )
+    {
+        if ( path.size() == 0 )
+        {
+            path.push_back( centreOf( goal ) );
+        }
+    }
+    else if ( path.size() == 0 )
+    {
+        path.push_back( to );
+    }
+    else
+    {
+        path.back() = to;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Fills route with a waypoint for every cluster that the trip passes through,
+// ending with the destination. Each leg is short enough to hand to findPath.
+bool
+NavGrid::findRoute( const b2Vec2 & from, const b2Vec2 & to,
+                    std::vector< b2Vec2 > & route )
+{
+    route.clear();
+
+    int start( nearestFree( cellAt( from ) ) );
+    int goal( cellAt( to ) );
+    bool snapped( goal >= 0 && isBlocked( goal ) );
+    goal = nearestFree( goal );
+    if ( start < 0 || goal < 0 )
+    {
+        return false;
+    }
+    b2Vec2 destination( snapped ? centreOf( goal ) : to );
+
+    int first( _clusterOf( start ) );
+    int last( _clusterOf( goal ) );
+    if ( m_clusters.size() == 0 || first == last )
+    {
+        route.push_back( destination );
+        return true;
+    }
+
+    const Cluster & source( m_clusters[first] );
+    const Cluster & target( m_clusters[last] );
+    std::vector< float > leaving;
+    std::vector< float > arriving;
+    _sweep( start, first, source.nodes, leaving );
+    _sweep( goal, last, target.nodes, arriving );
+
+    unsigned int open( _nextGeneration() );
+    unsigned int closed( open + 1 );
+
+    m_open.clear();
+    m_stamp[start] = open;
+    m_cost[start] = 0.0f;
+    m_parent[start] = -1;
+    OpenNode node;
+    node.cost = octile( start, goal );
+    node.cell = start;
+    m_open.push_back( node );
+
+    std::vector< int > next;
+    std::vector< float > steps;
+    bool found( false );
+
+    while ( m_open.size() > 0 )
+    {
+        std::pop_heap( m_open.begin(), m_open.end() );
+        int cell( m_open.back().cell );
+        m_open.pop_back();
+
+        if ( m_stamp[cell] == closed )
+        {
+            continue;
+        }
+        m_stamp[cell] = closed;
+
+        if ( cell == goal )
+        {
+            found = true;
+            break;
+        }
+
+        // A cell in the corner of a cluster can be an entrance on both of its
+        // sides, and so appear as more than one node. Every one of them leads
+        // across to its own partner.
+        next.clear();
+        steps.clear();
+        if ( cell == start )
+        {
+            next = source.nodes;
+            steps = leaving;
+            for ( unsigned int j = 0; j < source.nodes.size(); ++j )
+            {
+                if ( source.nodes[j] == cell )
+                {
+                    next.push_back( source.partners[j] );
+                    steps.push_back( 1.0f );
+                }
+            }
+        }
+        else
+        {
+            int index( _clusterOf( cell ) );
+            const Cluster & cluster( m_clusters[index] );
+            unsigned int size( cluster.nodes.size() );
+            unsigned int k( std::find( cluster.nodes.begin(),
+                                       cluster.nodes.end(), cell ) -
+                            cluster.nodes.begin() );
+            for ( unsigned int j = 0; j < size; ++j )
+            {
+                if ( cluster.nodes[j] == cell )
+                {
+                    next.push_back( cluster.partners[j] );
+                    steps.push_back( 1.0f );
+                }
+                else
+                {
+                    next.push_back( cluster.nodes[j] );
+                    steps.push_back( cluster.costs[k * size + j] );
+                }
+            }
+            if ( index == last )
+            {
+                next.push_back( goal );
+                steps.push_back( arriving[k] );
+            }
+        }
+
+        for ( unsigned int j = 0; j < next.size(); ++j )
+        {
+            if ( steps[j] >= UNREACHABLE || m_stamp[next[j]] == closed )
+            {
+                continue;
+            }
+            float cost( m_cost[cell] + steps[j] );
+            if ( m_stamp[next[j]] == open && cost >= m_cost[next[j]] )
+            {
+                continue;
+            }
+            m_stamp[next[j]] = open;
+            m_cost[next[j]] = cost;
+            m_parent[next[j]] = cell;
+            node.cost = cost + octile( next[j], goal );
+            node.cell = next[j];
+            m_open.push_back( node );
+            std::push_heap( m_open.begin(), m_open.end() );
+        }
+    }
+
+    if ( ! found )
+    {
+        return false;
+    }
+
+    // Keep the cells where the route crosses into another cluster.
+    for ( int cell = goal; m_parent[cell] >= 0; cell = m_parent[cell] )
+    {
+        int previous( m_parent[cell] );
+        if ( cell != goal && _clusterOf( cell ) != _clusterOf( previous ) )
+        {
+            route.push_back( centreOf( cell ) );
+        }
+    }
+    std::reverse( route.begin(), route.end() );
+    route.push_back( destination );
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Plans every start to its goal twice, first with an empty cache and then with
+// a warm one, and logs how many paths per second each run managed.
+void
+NavGrid::benchmark( const std::vector< b2Vec2 > & starts,
+                    const std::vector< b2Vec2 > & goals )
+{
+    HGE * hge( Engine::hge() );
+    unsigned int count( starts.size() < goals.size() ? starts.size()
+                                                     : goals.size() );
+    if ( count == 0 )
+    {
+        return;
+    }
+
+    m_lru.clear();
+    m_cache.clear();
+    m_hits = 0;
+    m_misses = 0;
+
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER begin;
+    LARGE_INTEGER middle;
+    LARGE_INTEGER end;
+    QueryPerformanceFrequency( & frequency );
+
+    std::vector< b2Vec2 > path;
+    unsigned int found( 0 );
+    QueryPerformanceCounter( & begin );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        if ( findPath( starts[i], goals[i], path ) )
+        {
+            ++found;
+        }
+    }
+    QueryPerformanceCounter( & middle );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        findPath( starts[i], goals[i], path );
+    }
+    QueryPerformanceCounter( & end );
+
+    double scale( static_cast< double >( frequency.QuadPart ) );
+    double cold( static_cast< double >( middle.QuadPart - begin.QuadPart ) );
+    double warm( static_cast< double >( end.QuadPart - middle.QuadPart ) );
+
+    hge->System_Log( "Navigation: %d paths (%d found), %.0f paths/sec cold, "
+                     "%.0f paths/sec cached, %d hits, %d misses",
+                     count, found,
+                     cold > 0.0 ? count * scale / cold : 0.0,
+                     warm > 0.0 ? count * scale / warm : 0.0,
+                     m_hits, m_misses );
+
+    // Routes over the cluster graph, which is what long trips actually use.
+    std::vector< b2Vec2 > route;
+    double total( 0.0 );
+    double worst( 0.0 );
+    found = 0;
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        QueryPerformanceCounter( & begin );
+        if ( findRoute( starts[i], goals[i], route ) )
+        {
+            ++found;
+        }
+        QueryPerformanceCounter( & end );
+        double elapsed( static_cast< double >( end.QuadPart -
+                                               begin.QuadPart ) );
+        total += elapsed;
+        if ( elapsed > worst )
+        {
+            worst = elapsed;
+        }
+    }
+
+    hge->System_Log( "Navigation: %d routes (%d found), %.0f routes/sec, "
+                     "%.3fms mean, %.3fms worst",
+                     count, found,
+                     total > 0.0 ? count * scale / total : 0.0,
+                     1000.0 * total / ( count * scale ),
+                     1000.0 * worst / scale );
+}
+
+//------------------------------------------------------------------------------
+unsigned long long
+NavGrid::buildingKey( int index )
+{
+    return KEY_BUILDING | static_cast< unsigned int >( index );
+}
+
+//------------------------------------------------------------------------------
+unsigned long long
+NavGrid::pointKey( int cell )
+{
+    return KEY_POINT | static_cast< unsigned int >( cell );
+}
+
+//------------------------------------------------------------------------------
+// Units register the destination they're heading for, so that we know which
+// destinations are worth a flow field.
+int
+NavGrid::addFlowUser( unsigned long long key )
+{
+    return m_users[key] += 1;
+}
+
+//------------------------------------------------------------------------------
+void
+NavGrid::removeFlowUser( unsigned long long key )
+{
+    std::map< unsigned long long, int >::iterator i( m_users.find( key ) );
+    if ( i != m_users.end() && --i->second <= 0 )
+    {
+        m_users.erase( i );
+    }
+}
+
+//------------------------------------------------------------------------------
+int
+NavGrid::getFlowUsers( unsigned long long key )
+{
+    std::map< unsigned long long, int >::iterator i( m_users.find( key ) );
+    return i == m_users.end() ? 0 : i->second;
+}
+
+//------------------------------------------------------------------------------
+// Looks a few cells down the flow from the given position and returns the
+// furthest of them that can be seen, so that units cut across open ground
+// instead of zig-zagging from cell to cell. Returns false once the unit has
+// arrived, or if the destination can't be reached from where it is.
+bool
+NavGrid::followFlow( unsigned long long key, const b2AABB & area,
+                     const b2Vec2 & position, b2Vec2 & waypoint )
+{
+    const std::vector< unsigned char > & directions(
+        _flowField( key, area ).directions );
+
+    int cell( nearestFree( cellAt( position ) ) );
+    if ( cell < 0 || directions[cell] >= FLOW_GOAL )
+    {
+        return false;
+    }
+
+    for ( int i = 0; i < FLOW_LOOKAHEAD; ++i )
+    {
+        unsigned char direction( directions[cell] );
+        if ( direction >= FLOW_GOAL )
+        {
+            break;
+        }
+        int next( cell + DY[direction] * GRID_WIDTH + DX[direction] );
+        if ( i > 0 && ! hasLineOfSight( position, centreOf( next ) ) )
+        {
+            break;
+        }
+        cell = next;
+    }
+    waypoint = centreOf( cell );
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+int
+NavGrid::getWidth()
+{
+    return GRID_WIDTH;
+}
+
+//------------------------------------------------------------------------------
+int
+NavGrid::getHeight()
+{
+    return GRID_HEIGHT;
+}
+
+//------------------------------------------------------------------------------
+float
+NavGrid::getCellSize()
+{
+    return CELL_SIZE;
+}
+
+//------------------------------------------------------------------------------
+// Returns -1 for points outside the world.
+int
+NavGrid::cellAt( const b2Vec2 & point )
+{
+    float fx( ( point.x - WORLD_MIN ) / CELL_SIZE );
+    float fy( ( point.y - WORLD_MIN ) / CELL_SIZE );
+    int x( static_cast< int >( floorf( fx ) ) );
+    int y( static_cast< int >( floorf( fy ) ) );
+    if ( x < 0 || y < 0 || x >= GRID_WIDTH || y >= GRID_HEIGHT )
+    {
+        return -1;
+    }
+    return y * GRID_WIDTH + x;
+}
+
+//------------------------------------------------------------------------------
+b2Vec2
+NavGrid::centreOf( int cell )
+{
+    return b2Vec2( WORLD_MIN + ( cell % GRID_WIDTH + 0.5f ) * CELL_SIZE,
+                   WORLD_MIN + ( cell / GRID_WIDTH + 0.5f ) * CELL_SIZE );
+}
+
+//------------------------------------------------------------------------------
+bool
+NavGrid::isBlocked( int cell )
+{
+    return m_blocked[cell] != 0;
+}
+
+//------------------------------------------------------------------------------
+// Searches outwards in growing squares for the closest unblocked cell. Returns
+// -1 if there is none nearby.
+int
+NavGrid::nearestFree( int cell )
+{
+    if ( cell < 0 || ! isBlocked( cell ) )
+    {
+        return cell;
+    }
+
+    int cx( cell % GRID_WIDTH );
+    int cy( cell / GRID_WIDTH );
+    for ( int radius = 1; radius <= SNAP_RADIUS; ++radius )
+    {
+        int best( -1 );
+        int bestDistance( 0 );
+        for ( int y = cy - radius; y <= cy + radius; ++y )
+        {
+            for ( int x = cx - radius; x <= cx + radius; ++x )
+            {
+                if ( abs( x - cx ) != radius && abs( y - cy ) != radius )
+                {
+                    continue;
+                }
+                if ( x < 0 || y < 0 || x >= GRID_WIDTH || y >= GRID_HEIGHT )
+                {
+                    continue;
+                }
+                int candidate( y * GRID_WIDTH + x );
+                int distance( ( x - cx ) * ( x - cx ) +
+                              ( y - cy ) * ( y - cy ) );
+                if ( ! isBlocked( candidate ) &&
+                     ( best < 0 || distance < bestDistance ) )
+                {
+                    best = candidate;
+                    bestDistance = distance;
+                }
+            }
+        }
+        if ( best >= 0 )
+        {
+            return best;
+        }
+    }
+
+    return -1;
+}
+
+//------------------------------------------------------------------------------
+bool
+NavGrid::hasLineOfSight( const b2Vec2 & from, const b2Vec2 & to )
+{
+    b2Vec2 delta( to - from );
+    float length( delta.Length() );
+    int steps( static_cast< int >( length / ( 0.25f * CELL_SIZE ) ) + 1 );
+    for ( int i = 0; i <= steps; ++i )
+    {
+        b2Vec2 point( from + ( static_cast< float >( i ) / steps ) * delta );
+        int cell( cellAt( point ) );
+        if ( cell < 0 || isBlocked( cell ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+// A cell is blocked if its centre or any of its corners is inside the shape,
+// which errs on the side of keeping units away from walls.
+void
+NavGrid::_rasterise( b2Shape * shape, const b2XForm & xform )
+{
+    b2AABB aabb;
+    shape->ComputeAABB( & aabb, xform );
+
+    int lower( cellAt( aabb.lowerBound ) );
+    int upper( cellAt( aabb.upperBound ) );
+    int x0( lower >= 0 ? lower % GRID_WIDTH : 0 );
+    int y0( lower >= 0 ? lower / GRID_WIDTH : 0 );
+    int x1( upper >= 0 ? upper % GRID_WIDTH : GRID_WIDTH - 1 );
+    int y1( upper >= 0 ? upper / GRID_WIDTH : GRID_HEIGHT - 1 );
+
+    float half( 0.5f * CELL_SIZE );
+    for ( int y = y0; y <= y1; ++y )
+    {
+        for ( int x = x0; x <= x1; ++x )
+        {
+            int cell( y * GRID_WIDTH + x );
+            if ( m_blocked[cell] != 0 )
+            {
+                continue;
+            }
+            b2Vec2 centre( centreOf( cell ) );
+            if ( shape->TestPoint( xform, centre ) ||
+                 shape->TestPoint( xform, centre + b2Vec2( -half, -half ) ) ||
+                 shape->TestPoint( xform, centre + b2Vec2( half, -half ) ) ||
+                 shape->TestPoint( xform, centre + b2Vec2( -half, half ) ) ||
+                 shape->TestPoint( xform, centre + b2Vec2( half, half ) ) )
+            {
+                m_blocked[cell] = 1;
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Per-cell search state is only valid when its stamp matches the current
+// generation, so nothing needs clearing between searches; a stamp one past the
+// generation marks the cell as closed.
+unsigned int
+NavGrid::_nextGeneration()
+{
+    m_generation += 2;
+    if ( m_generation < 2 )
+    {
+        std::fill( m_stamp.begin(), m_stamp.end(), 0 );
+        m_generation = 1;
+    }
+    return m_generation;
+}
+
+//------------------------------------------------------------------------------
+// Returns the cell reached by moving from the given cell in the given
+// direction, along with the cost of the move, or -1 if the move isn't allowed.
+// Diagonal moves mustn't cut corners.
+int
+NavGrid::_step( int cell, int direction, float & cost )
+{
+    int x( cell % GRID_WIDTH );
+    int y( cell / GRID_WIDTH );
+    int nx( x + DX[direction] );
+    int ny( y + DY[direction] );
+    if ( nx < 0 || ny < 0 || nx >= GRID_WIDTH || ny >= GRID_HEIGHT )
+    {
+        return -1;
+    }
+    int next( ny * GRID_WIDTH + nx );
+    if ( m_blocked[next] != 0 )
+    {
+        return -1;
+    }
+    cost = 1.0f;
+    if ( direction >= 4 )
+    {
+        if ( m_blocked[y * GRID_WIDTH + nx] != 0 ||
+             m_blocked[ny * GRID_WIDTH + x] != 0 )
+        {
+            return -1;
+        }
+        cost = DIAGONAL;
+    }
+    return next;
+}
+
+//------------------------------------------------------------------------------
+// Eight-way A* over the grid.
+bool
+NavGrid::_search( int start, int goal, std::vector< int > & cells )
+{
+    cells.clear();
+
+    unsigned int open( _nextGeneration() );
+    unsigned int closed( open + 1 );
+
+    m_open.clear();
+    m_stamp[start] = open;
+    m_cost[start] = 0.0f;
+    m_parent[start] = -1;
+    OpenNode node;
+    node.cost = octile( start, goal );
+    node.cell = start;
+    m_open.push_back( node );
+
+    while ( m_open.size() > 0 )
+    {
+        std::pop_heap( m_open.begin(), m_open.end() );
+        int cell( m_open.back().cell );
+        m_open.pop_back();
+
+        if ( m_stamp[cell] == closed )
+        {
+            continue;
+        }
+        m_stamp[cell] = closed;
+
+        if ( cell == goal )
+        {
+            for ( int i = goal; i >= 0; i = m_parent[i] )
+            {
+                cells.push_back( i );
+            }
+            std::reverse( cells.begin(), cells.end() );
+            return true;
+        }
+
+        for ( int i = 0; i < 8; ++i )
+        {
+            float step( 0.0f );
+            int next( _step( cell, i, step ) );
+            if ( next < 0 || m_stamp[next] == closed )
+            {
+                continue;
+            }
+            float cost( m_cost[cell] + step );
+            if ( m_stamp[next] == open && cost >= m_cost[next] )
+            {
+                continue;
+            }
+            m_stamp[next] = open;
+            m_cost[next] = cost;
+            m_parent[next] = cell;
+            node.cost = cost + octile( next, goal );
+            node.cell = next;
+            m_open.push_back( node );
+            std::push_heap( m_open.begin(), m_open.end() );
+        }
+    }
+
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// Pulls the string tight, keeping only the first cell, the last cell and the
+// cells where the path has to turn.
+void
+NavGrid::_smooth( const std::vector< int > & cells,
+                  std::vector< int > & corners )
+{
+    corners.clear();
+    corners.push_back( cells.front() );
+
+    unsigned int anchor( 0 );
+    for ( unsigned int i = 2; i < cells.size(); ++i )
+    {
+        if ( ! hasLineOfSight( centreOf( cells[anchor] ),
+                               centreOf( cells[i] ) ) )
+        {
+            anchor = i - 1;
+            corners.push_back( cells[anchor] );
+        }
+    }
+    if ( cells.size() > 1 )
+    {
+        corners.push_back( cells.back() );
+    }
+}
+
+//------------------------------------------------------------------------------
+// The goal of a field is every free cell touching the given area, or the
+// nearest free cell to its centre if there are none.
+NavGrid::FlowField &
+NavGrid::_flowField( unsigned long long key, const b2AABB & area )
+{
+    std::map< unsigned long long, std::list< FlowField >::iterator >::iterator
+        i( m_fields.find( key ) );
+    if ( i != m_fields.end() )
+    {
+        m_flows.splice( m_flows.begin(), m_flows, i->second );
+        return * i->second;
+    }
+
+    // Fields that someone is still following are never evicted, or a busy map
+    // would have every unit integrating a fresh field every frame. The cache
+    // grows past its size instead, and shrinks again as destinations empty.
+    std::list< FlowField >::iterator j( m_flows.end() );
+    while ( m_flows.size() >= FLOW_CACHE_SIZE && j != m_flows.begin() )
+    {
+        --j;
+        if ( getFlowUsers( j->key ) == 0 )
+        {
+            m_fields.erase( j->key );
+            j = m_flows.erase( j );
+        }
+    }
+
+    b2Vec2 margin( CELL_SIZE, CELL_SIZE );
+    int lower( cellAt( area.lowerBound - margin ) );
+    int upper( cellAt( area.upperBound + margin ) );
+    std::vector< int > goals;
+    if ( lower >= 0 && upper >= 0 )
+    {
+        for ( int y = lower / GRID_WIDTH; y <= upper / GRID_WIDTH; ++y )
+        {
+            for ( int x = lower % GRID_WIDTH; x <= upper % GRID_WIDTH; ++x )
+            {
+                int cell( y * GRID_WIDTH + x );
+                if ( ! isBlocked( cell ) )
+                {
+                    goals.push_back( cell );
+                }
+            }
+        }
+    }
+    if ( goals.size() == 0 )
+    {
+        int cell( nearestFree(
+            cellAt( 0.5f * ( area.lowerBound + area.upperBound ) ) ) );
+        if ( cell >= 0 )
+        {
+            goals.push_back( cell );
+        }
+    }
+
+    m_flows.push_front( FlowField() );
+    FlowField & field( m_flows.front() );
+    field.key = key;
+    _integrate( goals, field.directions );
+    m_fields[key] = m_flows.begin();
+
+    return field;
+}
+
+//------------------------------------------------------------------------------
+// Dijkstra outwards from all of the goals at once, with the same moves as the
+// A* search. Each cell ends up pointing at the neighbour it was reached from.
+void
+NavGrid::_integrate( const std::vector< int > & goals,
+                     std::vector< unsigned char > & directions )
+{
+    directions.assign( GRID_WIDTH * GRID_HEIGHT, FLOW_NONE );
+
+    unsigned int open( _nextGeneration() );
+    unsigned int closed( open + 1 );
+
+    m_open.clear();
+    OpenNode node;
+    std::vector< int >::const_iterator i;
+    for ( i = goals.begin(); i != goals.end(); ++i )
+    {
+        m_stamp[* i] = open;
+        m_cost[* i] = 0.0f;
+        directions[* i] = FLOW_GOAL;
+        node.cost = 0.0f;
+        node.cell = * i;
+        m_open.push_back( node );
+    }
+    std::make_heap( m_open.begin(), m_open.end() );
+
+    while ( m_open.size() > 0 )
+    {
+        std::pop_heap( m_open.begin(), m_open.end() );
+        int cell( m_open.back().cell );
+        m_open.pop_back();
+
+        if ( m_stamp[cell] == closed )
+        {
+            continue;
+        }
+        m_stamp[cell] = closed;
+
+        for ( int j = 0; j < 8; ++j )
+        {
+            float step( 0.0f );
+            int next( _step( cell, j, step ) );
+            if ( next < 0 || m_stamp[next] == closed )
+            {
+                continue;
+            }
+            float cost( m_cost[cell] + step );
+            if ( m_stamp[next] == open && cost >= m_cost[next] )
+            {
+                continue;
+            }
+            m_stamp[next] = open;
+            m_cost[next] = cost;
+            // Moves come in opposing pairs, so flipping the low bit reverses.
+            directions[next] = static_cast< unsigned char >( j ^ 1 );
+            node.cost = cost;
+            node.cell = next;
+            m_open.push_back( node );
+            std::push_heap( m_open.begin(), m_open.end() );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+int
+NavGrid::_clusterOf( int cell )
+{
+    int x( ( cell % GRID_WIDTH ) / CLUSTER_SIZE );
+    int y( ( cell / GRID_WIDTH ) / CLUSTER_SIZE );
+    return y * CLUSTERS_X + x;
+}
+
+//------------------------------------------------------------------------------
+void
+NavGrid::_buildCluster( int index )
+{
+    Cluster & cluster( m_clusters[index] );
+    cluster.nodes.clear();
+    cluster.partners.clear();
+
+    int x0( ( index % CLUSTERS_X ) * CLUSTER_SIZE );
+    int y0( ( index / CLUSTERS_X ) * CLUSTER_SIZE );
+    int x1( x0 + CLUSTER_SIZE - 1 );
+    int y1( y0 + CLUSTER_SIZE - 1 );
+
+    if ( x0 > 0 )
+    {
+        _findEntrances( y0 * GRID_WIDTH + x0, y0 * GRID_WIDTH + x0 - 1,
+                        GRID_WIDTH, cluster );
+    }
+    if ( x1 < GRID_WIDTH - 1 )
+    {
+        _findEntrances( y0 * GRID_WIDTH + x1, y0 * GRID_WIDTH + x1 + 1,
+                        GRID_WIDTH, cluster );
+    }
+    if ( y0 > 0 )
+    {
+        _findEntrances( y0 * GRID_WIDTH + x0, ( y0 - 1 ) * GRID_WIDTH + x0,
+                        1, cluster );
+    }
+    if ( y1 < GRID_HEIGHT - 1 )
+    {
+        _findEntrances( y1 * GRID_WIDTH + x0, ( y1 + 1 ) * GRID_WIDTH + x0,
+                        1, cluster );
+    }
+
+    unsigned int size( cluster.nodes.size() );
+    cluster.costs.assign( size * size, UNREACHABLE );
+    std::vector< float > costs;
+    for ( unsigned int i = 0; i < size; ++i )
+    {
+        _sweep( cluster.nodes[i], index, cluster.nodes, costs );
+        std::copy( costs.begin(), costs.end(),
+                   cluster.costs.begin() + i * size );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Walks along one side of a cluster, alongside the matching side of its
+// neighbour, and adds a node for every gap where both are open. Long gaps get
+// a node at each end. The neighbour walks the same cells when it builds, so
+// the two always agree on where the nodes are.
+void
+NavGrid::_findEntrances( int inside, int outside, int stride,
+                         Cluster & cluster )
+{
+    int run( -1 );
+    for ( int i = 0; i <= CLUSTER_SIZE; ++i )
+    {
+        bool gap( i < CLUSTER_SIZE &&
+                  m_blocked[inside + i * stride] == 0 &&
+                  m_blocked[outside + i * stride] == 0 );
+        if ( gap && run < 0 )
+        {
+            run = i;
+        }
+        if ( gap || run < 0 )
+        {
+            continue;
+        }
+        int length( i - run );
+        if ( length >= LONG_ENTRANCE )
+        {
+            cluster.nodes.push_back( inside + run * stride );
+            cluster.partners.push_back( outside + run * stride );
+            cluster.nodes.push_back( inside + ( i - 1 ) * stride );
+            cluster.partners.push_back( outside + ( i - 1 ) * stride );
+        }
+        else
+        {
+            cluster.nodes.push_back( inside + ( run + length / 2 ) * stride );
+            cluster.partners.push_back( outside +
+                                        ( run + length / 2 ) * stride );
+        }
+        run = -1;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Dijkstra from one cell without leaving its cluster, giving the cost of
+// reaching each of the targets.
+void
+NavGrid::_sweep( int source, int index, const std::vector< int > & targets,
+                 std::vector< float > & costs )
+{
+    unsigned int open( _nextGeneration() );
+    unsigned int closed( open + 1 );
+
+    m_open.clear();
+    m_stamp[source] = open;
+    m_cost[source] = 0.0f;
+    OpenNode node;
+    node.cost = 0.0f;
+    node.cell = source;
+    m_open.push_back( node );
+
+    while ( m_open.size() > 0 )
+    {
+        std::pop_heap( m_open.begin(), m_open.end() );
+        int cell( m_open.back().cell );
+        m_open.pop_back();
+
+        if ( m_stamp[cell] == closed )
+        {
+            continue;
+        }
+        m_stamp[cell] = closed;
+
+        for ( int i = 0; i < 8; ++i )
+        {
+            float step( 0.0f );
+            int next( _step( cell, i, step ) );
+            if ( next < 0 || m_stamp[next] == closed ||
+                 _clusterOf( next ) != index )
+            {
+                continue;
+            }
+            float cost( m_cost[cell] + step );
+            if ( m_stamp[next] == open && cost >= m_cost[next] )
+            {
+                continue;
+            }
+            m_stamp[next] = open;
+            m_cost[next] = cost;
+            node.cost = cost;
+            node.cell = next;
+            m_open.push_back( node );
+            std::push_heap( m_open.begin(), m_open.end() );
+        }
+    }
+
+    costs.resize( targets.size() );
+    for ( unsigned int i = 0; i < targets.size(); ++i )
+    {
+        costs[i] = m_stamp[targets[i]] == closed ? m_cost[targets[i]]
+                                                 : UNREACHABLE;
+    }
+}
+
+//------------------------------------------------------------------------------
+const std::vector< int > *
+NavGrid::_lookup( unsigned long long key )
+{
+    std::map< unsigned long long, std::list< CachedPath >::iterator >::iterator
+        i( m_cache.find( key ) );
+    if ( i == m_cache.end() )
+    {
+        m_misses += 1;
+        return 0;
+    }
+    m_hits += 1;
+    m_lru.splice( m_lru.begin(), m_lru, i->second );
+    return & i->second->cells;
+}
+
+//------------------------------------------------------------------------------
+void
+NavGrid::_remember( unsigned long long key, const std::vector< int > & cells )
+{
+    if ( m_lru.size() >= CACHE_SIZE )
+    {
+        m_cache.erase( m_lru.back().key );
+        m_lru.pop_back();
+    }
+    CachedPath cached;
+    cached.key = key;
+    cached.cells = cells;
+    m_lru.push_front( cached );
+    m_cache[key] = m_lru.begin();
+}
+
+//==============================================================================
@@ -0,0 +1,134 @@
+//==============================================================================
+
+#ifndef ArseNav
+#define ArseNav
+
+#include <vector>
+#include <list>
+#include <map>
+
+#include <Box2D.h>
+
+//------------------------------------------------------------------------------
+// A coarse occupancy grid over the whole world, baked from its static bodies,
+// with an A* search for getting about on it. Found paths are kept in a small
+// LRU cache keyed by their start and goal cells, as units that are sent off
+// together tend to ask for the same path over and over.
+//
+// Destinations that many units share get a flow field instead: one pass over
+// the grid from the destination gives every cell the direction to head in, so
+// any number of units can find their way for the cost of a lookup. Fields are
+// cached by destination until the grid changes.
+//
+// Long trips are planned on an abstract graph first. The grid is divided into
+// square clusters, with a node either side of each gap in the border between
+// two clusters and the cost of travelling between the nodes of each cluster
+// worked out up front. A route across the city is then a quick search over
+// the nodes, and only the leg that a unit is currently on needs a path on the
+// grid itself. Clusters are rebuilt individually when the map is edited.
+class NavGrid
+{
+  public:
+    NavGrid();
+    ~NavGrid();
+
+  private:
+    NavGrid( const NavGrid & );
+    NavGrid & operator=( const NavGrid & );
+
+    struct OpenNode
+    {
+        float cost;
+        int cell;
+        bool operator<( const OpenNode & other ) const;
+    };
+
+    struct CachedPath
+    {
+        unsigned long long key;
+        std::vector< int > cells;
+    };
+
+    struct FlowField
+    {
+        unsigned long long key;
+        std::vector< unsigned char > directions;
+    };
+
+    struct Cluster
+    {
+        std::vector< int > nodes;
+        std::vector< int > partners;
+        std::vector< float > costs;
+    };
+
+  public:
+    void bake( b2World * world );
+    void rebuild( b2World * world, const b2AABB & area );
+    void clear();
+    unsigned int getVersion();
+
+    bool findPath( const b2Vec2 & from, const b2Vec2 & to,
+                   std::vector< b2Vec2 > & path );
+    bool findRoute( const b2Vec2 & from, const b2Vec2 & to,
+                    std::vector< b2Vec2 > & route );
+    void benchmark( const std::vector< b2Vec2 > & starts,
+                    const std::vector< b2Vec2 > & goals );
+
+    static unsigned long long buildingKey( int index );
+    static unsigned long long pointKey( int cell );
+    int addFlowUser( unsigned long long key );
+    void removeFlowUser( unsigned long long key );
+    int getFlowUsers( unsigned long long key );
+    bool followFlow( unsigned long long key, const b2AABB & area,
+                     const b2Vec2 & position, b2Vec2 & waypoint );
+
+    int getWidth();
+    int getHeight();
+    float getCellSize();
+    int cellAt( const b2Vec2 & point );
+    b2Vec2 centreOf( int cell );
+    bool isBlocked( int cell );
+    int nearestFree( int cell );
+    bool hasLineOfSight( const b2Vec2 & from, const b2Vec2 & to );
+
+  private:
+    void _rasterise( b2Shape * shape, const b2XForm & xform );
+    unsigned int _nextGeneration();
+    int _step( int cell, int direction, float & cost );
+    bool _search( int start, int goal, std::vector< int > & cells );
+    void _smooth( const std::vector< int > & cells,
+                  std::vector< int > & corners );
+    const std::vector< int > * _lookup( unsigned long long key );
+    void _remember( unsigned long long key, const std::vector< int > & cells );
+    FlowField & _flowField( unsigned long long key, const b2AABB & area );
+    void _integrate( const std::vector< int > & goals,
+                     std::vector< unsigned char > & directions );
+    int _clusterOf( int cell );
+    void _buildCluster( int index );
+    void _findEntrances( int inside, int outside, int stride,
+                         Cluster & cluster );
+    void _sweep( int source, int index, const std::vector< int > & targets,
+                 std::vector< float > & costs );
+
+  private:
+    unsigned int m_version;
+    std::vector< unsigned char > m_blocked;
+    std::vector< float > m_cost;
+    std::vector< int > m_parent;
+    std::vector< unsigned int > m_stamp;
+    unsigned int m_generation;
+    std::vector< OpenNode > m_open;
+    std::list< CachedPath > m_lru;
+    std::map< unsigned long long, std::list< CachedPath >::iterator > m_cache;
+    unsigned int m_hits;
+    unsigned int m_misses;
+    std::list< FlowField > m_flows;
+    std::map< unsigned long long, std::list< FlowField >::iterator > m_fields;
+    std::map< unsigned long long, int > m_users;
+    std::vector< Cluster > m_clusters;
+};
+
+#endif
+
+//==============================================================================
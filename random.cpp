@@ -0,0 +1,133 @@
+//==============================================================================
+
+#include <random.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const unsigned long long GOLDEN( 0x9E3779B97F4A7C15ULL );
+    const float UNIT( 1.0f / 16777216.0f );
+
+    // The SplitMix64 finaliser.
+    inline unsigned long long
+    mix( unsigned long long z )
+    {
+        z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+        z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+        return z ^ ( z >> 31 );
+    }
+
+    inline unsigned int
+    draw( unsigned long long seed, unsigned int tick, unsigned int key,
+          unsigned int stream )
+    {
+        unsigned long long counter( static_cast< unsigned long long >( key )
+                                    << 32 | stream );
+        unsigned long long z( mix( seed + counter * GOLDEN ) );
+        unsigned long long step( static_cast< unsigned long long >( tick ) + 1 );
+        z = mix( z + step * GOLDEN );
+        return static_cast< unsigned int >( z >> 32 );
+    }
+};
+
+//------------------------------------------------------------------------------
+
+unsigned long long Random::s_seed( 0 );
+unsigned int Random::s_tick( 0 );
+
+//------------------------------------------------------------------------------
+void
+Random::seed( int seed )
+{
+    s_seed = mix( static_cast< unsigned long long >( seed ) * GOLDEN );
+    s_tick = 0;
+}
+
+//------------------------------------------------------------------------------
+// Called once per simulation tick, before anything is updated.
+void
+Random::advance()
+{
+    s_tick += 1;
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+Random::getTick()
+{
+    return s_tick;
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+Random::bits( unsigned int key, unsigned int stream )
+{
+    return draw( s_seed, s_tick, key, stream );
+}
+
+//------------------------------------------------------------------------------
+// Returns a number in [0, 1).
+float
+Random::uniform( unsigned int key, unsigned int stream )
+{
+    return static_cast< float >( bits( key, stream ) >> 8 ) * UNIT;
+}
+
+//------------------------------------------------------------------------------
+float
+Random::range( unsigned int key, unsigned int stream, float min, float max )
+{
+    return min + uniform( key, stream ) * ( max - min );
+}
+
+//------------------------------------------------------------------------------
+// Both limits are inclusive, as with HGE.
+int
+Random::integer( unsigned int key, unsigned int stream, int min, int max )
+{
+    if ( max <= min )
+    {
+        return min;
+    }
+    unsigned int span( static_cast< unsigned int >( max - min ) + 1 );
+    unsigned long long scaled( static_cast< unsigned long long >(
+                                   bits( key, stream ) ) * span );
+    return min + static_cast< int >( scaled >> 32 );
+}
+
+//------------------------------------------------------------------------------
+// Fills values with uniforms drawn from count consecutive streams of one key.
+void
+Random::sequence( unsigned int key, unsigned int stream, unsigned int count,
+                  float * values )
+{
+    unsigned long long seed( s_seed );
+    unsigned int tick( s_tick );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        values[i] =
+            static_cast< float >( draw( seed, tick, key, stream + i ) >> 8 ) *
+            UNIT;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Fills values with one uniform per key from the same stream, so that a whole
+// crowd can make its decision in a single pass. Each iteration is independent
+// of the others, so the work may be split across threads in any way.
+void
+Random::uniforms( const unsigned int * keys, unsigned int count,
+                  unsigned int stream, float * values )
+{
+    unsigned long long seed( s_seed );
+    unsigned int tick( s_tick );
+    for ( unsigned int i = 0; i < count; ++i )
+    {
+        values[i] =
+            static_cast< float >( draw( seed, tick, keys[i], stream ) >> 8 ) *
+            UNIT;
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,43 @@
+//==============================================================================
+
+#ifndef ArseRandom
+#define ArseRandom
+
+//------------------------------------------------------------------------------
+// Counter-based random numbers for the simulation. Every draw is a pure hash
+// of the mission seed, the current tick, a key (the entity's index into the
+// cached world) and a stream number that tells apart several draws made by
+// the same entity on the same tick. Nothing is consumed, so results don't
+// depend on update order and any thread may draw at any time.
+class Random
+{
+  public:
+    static void seed( int seed );
+    static void advance();
+    static unsigned int getTick();
+
+    static unsigned int bits( unsigned int key, unsigned int stream );
+    static float uniform( unsigned int key, unsigned int stream );
+    static float range( unsigned int key, unsigned int stream,
+                        float min, float max );
+    static int integer( unsigned int key, unsigned int stream,
+                        int min, int max );
+
+    static void sequence( unsigned int key, unsigned int stream,
+                          unsigned int count, float * values );
+    static void uniforms( const unsigned int * keys, unsigned int count,
+                          unsigned int stream, float * values );
+
+  private:
+    Random();
+    Random( const Random & );
+    Random & operator=( const Random & );
+
+  private:
+    static unsigned long long s_seed;
+    static unsigned int s_tick;
+};
+
+#endif
+
+//==============================================================================
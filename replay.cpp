@@ -0,0 +1,255 @@
+//==============================================================================
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <engine.hpp>
+#include <entity.hpp>
+#include <replay.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const unsigned int HASH_INTERVAL( 60 );
+    const unsigned int FNV_OFFSET( 2166136261u );
+    const unsigned int FNV_PRIME( 16777619u );
+
+    void
+    hashBytes( unsigned int & hash, const void * data, unsigned int size )
+    {
+        const unsigned char * bytes(
+            static_cast< const unsigned char * >( data ) );
+        for ( unsigned int i = 0; i < size; ++i )
+        {
+            hash = ( hash ^ bytes[i] ) * FNV_PRIME;
+        }
+    }
+
+    void
+    hashFloat( unsigned int & hash, float value )
+    {
+        hashBytes( hash, & value, sizeof( float ) );
+    }
+
+    void
+    hashInt( unsigned int & hash, int value )
+    {
+        hashBytes( hash, & value, sizeof( int ) );
+    }
+};
+
+//------------------------------------------------------------------------------
+Replay::Replay()
+    :
+    m_recording( false ),
+    m_seed( 0 ),
+    m_deltas(),
+    m_paused(),
+    m_orders(),
+    m_decisions(),
+    m_hashes(),
+    m_start( 0 )
+{
+}
+
+//------------------------------------------------------------------------------
+Replay::~Replay()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+Replay::start( int seed, const std::vector< Entity * > & entities )
+{
+    m_recording = true;
+    m_seed = seed;
+    m_deltas.clear();
+    m_paused.clear();
+    m_orders.clear();
+    m_decisions.clear();
+    m_hashes.clear();
+    m_start = hashWorld( entities );
+}
+
+//------------------------------------------------------------------------------
+void
+Replay::stop()
+{
+    m_recording = false;
+}
+
+//------------------------------------------------------------------------------
+void
+Replay::resume()
+{
+    m_recording = true;
+}
+
+//------------------------------------------------------------------------------
+bool
+Replay::isRecording()
+{
+    return m_recording;
+}
+
+//------------------------------------------------------------------------------
+void
+Replay::tick( float dt, bool paused,
+              const std::vector< Entity * > & entities )
+{
+    if ( ! m_recording )
+    {
+        return;
+    }
+    m_deltas.push_back( dt );
+    m_paused.push_back( paused );
+    if ( m_deltas.size() % HASH_INTERVAL == 0 )
+    {
+        m_hashes.push_back( hashWorld( entities ) );
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+Replay::order( ActionType action, Entity * target, const b2Vec2 & point,
+               const std::vector< Guy * > & team )
+{
+    if ( ! m_recording || m_deltas.size() == 0 )
+    {
+        return;
+    }
+
+    ReplayOrder order;
+    order.tick = m_deltas.size() - 1;
+    order.action = action;
+    order.target = ( target != 0 ) ? target->getIndex() : -1;
+    order.point = point;
+    std::vector< Guy * >::const_iterator i;
+    for ( i = team.begin(); i != team.end(); ++i )
+    {
+        order.team.push_back( ( * i )->getIndex() );
+    }
+    m_orders.push_back( order );
+}
+
+//------------------------------------------------------------------------------
+// Decisions are made after the simulation but before the tick is recorded, so
+// they belong to the tick that's about to be.
+void
+Replay::decide( const std::vector< Guy * > & decided )
+{
+    if ( ! m_recording )
+    {
+        return;
+    }
+
+    std::vector< Guy * >::const_iterator i;
+    for ( i = decided.begin(); i != decided.end(); ++i )
+    {
+        ReplayDecision decision;
+        decision.tick = m_deltas.size();
+        decision.entity = ( * i )->getIndex();
+        m_decisions.push_back( decision );
+    }
+}
+
+//------------------------------------------------------------------------------
+int
+Replay::getSeed()
+{
+    return m_seed;
+}
+
+//------------------------------------------------------------------------------
+const std::vector< float > &
+Replay::getDeltas()
+{
+    return m_deltas;
+}
+
+//------------------------------------------------------------------------------
+// Paused ticks still step the physics, but nothing else is simulated.
+bool
+Replay::wasPaused( unsigned int tick )
+{
+    return tick < m_paused.size() && m_paused[tick];
+}
+
+//------------------------------------------------------------------------------
+const std::vector< ReplayOrder > &
+Replay::getOrders()
+{
+    return m_orders;
+}
+
+//------------------------------------------------------------------------------
+const std::vector< ReplayDecision > &
+Replay::getDecisions()
+{
+    return m_decisions;
+}
+
+//------------------------------------------------------------------------------
+// Called before the first tick, to check that playback starts from the world
+// that was recorded.
+bool
+Replay::checkStart( const std::vector< Entity * > & entities )
+{
+    return m_start == hashWorld( entities );
+}
+
+//------------------------------------------------------------------------------
+// Called after the given tick has been simulated. Ticks that weren't hashed
+// while recording always pass.
+bool
+Replay::checkHash( unsigned int tick, const std::vector< Entity * > & entities )
+{
+    if ( ( tick + 1 ) % HASH_INTERVAL != 0 )
+    {
+        return true;
+    }
+    unsigned int index( ( tick + 1 ) / HASH_INTERVAL - 1 );
+    if ( index >= m_hashes.size() )
+    {
+        return true;
+    }
+    return m_hashes[index] == hashWorld( entities );
+}
+
+//------------------------------------------------------------------------------
+//static:
+//------------------------------------------------------------------------------
+unsigned int
+Replay::hashWorld( const std::vector< Entity * > & entities )
+{
+    unsigned int hash( FNV_OFFSET );
+
+    std::vector< Entity * >::const_iterator i;
+    for ( i = entities.begin(); i != entities.end(); ++i )
+    {
+        Entity * entity( * i );
+        if ( entity == 0 )
+        {
+            continue;
+        }
+        b2Body * body( entity->getBody() );
+        if ( ! body->IsDynamic() )
+        {
+            continue;
+        }
+        hashFloat( hash, body->GetPosition().x );
+        hashFloat( hash, body->GetPosition().y );
+        hashFloat( hash, body->GetAngle() );
+        hashFloat( hash, body->GetLinearVelocity().x );
+        hashFloat( hash, body->GetLinearVelocity().y );
+        hashFloat( hash, body->GetAngularVelocity() );
+        hashInt( hash, body->IsSleeping() ? 1 : 0 );
+        hashInt( hash, entity->getAllegiance() );
+        hashInt( hash, entity->getVisible() ? 1 : 0 );
+    }
+
+    return hash;
+}
+
+//==============================================================================
@@ -0,0 +1,87 @@
+//==============================================================================
+
+#ifndef ArseReplay
+#define ArseReplay
+
+#include <vector>
+
+#include <Box2D.h>
+
+#include <actions.hpp>
+
+class Entity;
+class Guy;
+
+//------------------------------------------------------------------------------
+// An order given to the team, stamped with the tick it was issued on. Entities
+// are stored by their index into the cached world.
+struct ReplayOrder
+{
+    unsigned int tick;
+    ActionType action;
+    int target;
+    b2Vec2 point;
+    std::vector< int > team;
+};
+
+//------------------------------------------------------------------------------
+// A decision made by the AI scheduler, which depends on how much time there was
+// to spare, and so has to be recorded rather than made again.
+struct ReplayDecision
+{
+    unsigned int tick;
+    int entity;
+};
+
+//------------------------------------------------------------------------------
+// Records a mission as its random seed, the time delta of every tick, whether
+// the game was paused for it, and the orders and decisions made along the way,
+// which is all it takes to play it back exactly.
+// A hash of the world is stored at the start and every so often after that, so
+// that playback can check that the simulation hasn't diverged.
+class Replay
+{
+  public:
+    Replay();
+    ~Replay();
+
+  private:
+    Replay( const Replay & );
+    Replay & operator=( const Replay & );
+
+  public:
+    void start( int seed, const std::vector< Entity * > & entities );
+    void stop();
+    void resume();
+    bool isRecording();
+    void tick( float dt, bool paused,
+               const std::vector< Entity * > & entities );
+    void order( ActionType action, Entity * target, const b2Vec2 & point,
+                const std::vector< Guy * > & team );
+    void decide( const std::vector< Guy * > & decided );
+
+    int getSeed();
+    const std::vector< float > & getDeltas();
+    bool wasPaused( unsigned int tick );
+    const std::vector< ReplayOrder > & getOrders();
+    const std::vector< ReplayDecision > & getDecisions();
+    bool checkStart( const std::vector< Entity * > & entities );
+    bool checkHash( unsigned int tick,
+                    const std::vector< Entity * > & entities );
+
+    static unsigned int hashWorld( const std::vector< Entity * > & entities );
+
+  private:
+    bool m_recording;
+    int m_seed;
+    std::vector< float > m_deltas;
+    std::vector< bool > m_paused;
+    std::vector< ReplayOrder > m_orders;
+    std::vector< ReplayDecision > m_decisions;
+    std::vector< unsigned int > m_hashes;
+    unsigned int m_start;
+};
+
+#endif
+
+//==============================================================================
@@ -0,0 +1,625 @@
+//==============================================================================
+
+#include <cstdio>
+#include <process.h>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <engine.hpp>
+#include <entity.hpp>
+#include <actions.hpp>
+#include <cache.hpp>
+#include <savegame.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const unsigned int SAVE_MAGIC( 0x47535755 );
+    const unsigned int SAVE_VERSION( 1 );
+    const unsigned int KEYFRAME_INTERVAL( 12 );
+    const unsigned int RECORD_WORDS( sizeof( EntityRecord ) / 4 );
+    const int RECORD_VISIBLE( 0x100 );
+    const int RECORD_ALLEGIANCE( 0xFF );
+    const int RECORD_RELEASED( 0x200 );
+
+    enum ChunkType
+    {
+        CHUNK_KEYFRAME = 0,
+        CHUNK_DELTA = 1
+    };
+
+    struct ChunkHeader
+    {
+        unsigned int magic;
+        unsigned int version;
+        unsigned int type;
+        unsigned int sequence;
+        unsigned int keysequence;
+        unsigned int count;
+        unsigned int words;
+    };
+};
+
+//------------------------------------------------------------------------------
+SaveGame::SaveGame( const char * filename )
+    :
+    m_filename( filename ),
+    m_thread( 0 ),
+    m_wake( 0 ),
+    m_idle( 0 ),
+    m_lock(),
+    m_quit( false ),
+    m_pending( false ),
+    m_queued(),
+    m_keyframe(),
+    m_sequence( 0 ),
+    m_keysequence( 0 )
+{
+    InitializeCriticalSection( & m_lock );
+    m_wake = CreateEvent( NULL, FALSE, FALSE, NULL );
+    m_idle = CreateEvent( NULL, TRUE, TRUE, NULL );
+    m_thread = reinterpret_cast< HANDLE >(
+        _beginthreadex( NULL, 0, s_run, this, 0, NULL ) );
+}
+
+//------------------------------------------------------------------------------
+SaveGame::~SaveGame()
+{
+    EnterCriticalSection( & m_lock );
+    m_quit = true;
+    LeaveCriticalSection( & m_lock );
+    SetEvent( m_wake );
+    WaitForSingleObject( m_thread, INFINITE );
+    CloseHandle( m_thread );
+    CloseHandle( m_wake );
+    CloseHandle( m_idle );
+    DeleteCriticalSection( & m_lock );
+}
+
+//------------------------------------------------------------------------------
+void
+SaveGame::save( const std::vector< Entity * > & entities )
+{
+    std::vector< EntityRecord > records;
+    capture( entities, records );
+
+    EnterCriticalSection( & m_lock );
+    m_queued.swap( records );
+    m_pending = true;
+    ResetEvent( m_idle );
+    LeaveCriticalSection( & m_lock );
+
+    SetEvent( m_wake );
+}
+
+//------------------------------------------------------------------------------
+bool
+SaveGame::load( const std::vector< Entity * > & entities )
+{
+    flush();
+
+    std::vector< EntityRecord > records;
+    if ( ! _read( entities.size(), records ) )
+    {
+        return false;
+    }
+    if ( records.size() != entities.size() )
+    {
+        Engine::hge()->System_Log( "Saved game doesn't match the world" );
+        return false;
+    }
+    if ( ! _validate( records ) )
+    {
+        Engine::hge()->System_Log( "Corrupt saved game" );
+        return false;
+    }
+
+    Engine::wc()->restore();
+    apply( entities, records );
+
+    // Deltas are only ever taken against a keyframe this session has written.
+    m_keyframe.clear();
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void
+SaveGame::flush()
+{
+    WaitForSingleObject( m_idle, INFINITE );
+}
+
+//------------------------------------------------------------------------------
+//static:
+//------------------------------------------------------------------------------
+void
+SaveGame::capture( const std::vector< Entity * > & entities,
+                   std::vector< EntityRecord > & records )
+{
+    records.resize( entities.size() );
+
+    for ( unsigned int i = 0; i < entities.size(); ++i )
+    {
+        Entity * entity( entities[i] );
+        EntityRecord & record( records[i] );
+        if ( entity == 0 )
+        {
+            record = EntityRecord();
+            record.flags = RECORD_RELEASED;
+            record.container = -1;
+            record.action = TYPE_NONE;
+            record.target = -1;
+            continue;
+        }
+        b2Body * body( entity->getBody() );
+
+        record.x = body->GetPosition().x;
+        record.y = body->GetPosition().y;
+        record.angle = body->GetAngle();
+        record.vx = body->GetLinearVelocity().x;
+        record.vy = body->GetLinearVelocity().y;
+        record.spin = body->GetAngularVelocity();
+        record.strength = 0.0f;
+        record.damage = 0.0f;
+        record.flags = entity->getAllegiance() & RECORD_ALLEGIANCE;
+        if ( entity->getVisible() )
+        {
+            record.flags |= RECORD_VISIBLE;
+        }
+        record.container = -1;
+        record.action = TYPE_NONE;
+        record.target = -1;
+        record.tx = 0.0f;
+        record.ty = 0.0f;
+
+        Damageable * damageable( 0 );
+        switch ( entity->getType() )
+        {
+            case TYPE_CAR:
+            {
+                damageable = static_cast< Car * >( entity );
+                break;
+            }
+            case TYPE_GUY:
+            {
+                damageable = static_cast< Guy * >( entity );
+                break;
+            }
+            case TYPE_BUILDING:
+            {
+                Building * building( static_cast< Building * >( entity ) );
+                if ( building->getMeta()->getOwner() == building )
+                {
+                    damageable = building->getMeta();
+                }
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+        if ( damageable != 0 )
+        {
+            record.strength = damageable->getStrength();
+            record.damage = damageable->getDamage();
+        }
+
+        if ( entity->getContainer() != 0 )
+        {
+            Entity * holder( entity->getContainer()->getContainerEntity() );
+            record.container = holder->getIndex();
+        }
+
+        for ( int type = TYPE_MOVE; type <= TYPE_AIRSTRIKE; ++type )
+        {
+            Action * action(
+                entity->getAction( static_cast< ActionType >( type ) ) );
+            if ( action == 0 )
+            {
+                continue;
+            }
+            Target * target( action->getTarget() );
+            record.action = type;
+            if ( target->getEntity() != 0 )
+            {
+                record.target = target->getEntity()->getIndex();
+            }
+            else
+            {
+                record.tx = target->getPosition().x;
+                record.ty = target->getPosition().y;
+            }
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Expects a freshly restored world, with nothing contained and no actions.
+// Entities that have been released on either side are left alone.
+void
+SaveGame::apply( const std::vector< Entity * > & entities,
+                 const std::vector< EntityRecord > & records )
+{
+    for ( unsigned int i = 0; i < entities.size(); ++i )
+    {
+        Entity * entity( entities[i] );
+        const EntityRecord & record( records[i] );
+        if ( entity == 0 || ( record.flags & RECORD_RELEASED ) != 0 )
+        {
+            continue;
+        }
+        b2Body * body( entity->getBody() );
+
+        entity->setAllegiance( static_cast< EntityAllegiance >(
+                                   record.flags & RECORD_ALLEGIANCE ) );
+        entity->setVisible( ( record.flags & RECORD_VISIBLE ) != 0 );
+
+        if ( ! body->IsDynamic() )
+        {
+            if ( entity->getType() == TYPE_BUILDING )
+            {
+                Building * building( static_cast< Building * >( entity ) );
+                if ( building->getMeta()->getOwner() == building )
+                {
+                    building->getMeta()->restoreDamageable( record.strength,
+                                                            record.damage );
+                }
+            }
+            continue;
+        }
+
+        b2Vec2 position( record.x, record.y );
+        b2Vec2 velocity( record.vx, record.vy );
+        body->SetXForm( position, record.angle );
+        body->SetLinearVelocity( velocity );
+        body->SetAngularVelocity( record.spin );
+        if ( velocity.LengthSquared() > 0.0f || record.spin != 0.0f )
+        {
+            body->WakeUp();
+        }
+
+        if ( entity->getType() == TYPE_CAR )
+        {
+            static_cast< Car * >( entity )->restoreDamageable( record.strength,
+                                                               record.damage );
+        }
+        else if ( entity->getType() == TYPE_GUY )
+        {
+            static_cast< Guy * >( entity )->restoreDamageable( record.strength,
+                                                               record.damage );
+        }
+    }
+
+    for ( unsigned int i = 0; i < entities.size(); ++i )
+    {
+        Entity * entity( entities[i] );
+        const EntityRecord & record( records[i] );
+        if ( entity == 0 || ( record.flags & RECORD_RELEASED ) != 0 )
+        {
+            continue;
+        }
+
+        if ( record.action != TYPE_NONE )
+        {
+            Target * target( 0 );
+            if ( record.target >= 0 &&
+                 record.target < static_cast< int >( entities.size() ) &&
+                 entities[record.target] != 0 )
+            {
+                target = new Target( entities[record.target] );
+            }
+            else
+            {
+                target = new Target( b2Vec2( record.tx, record.ty ) );
+            }
+            entity->addAction( Action::factory(
+                static_cast< ActionType >( record.action ), target ) );
+        }
+    }
+
+    // Starting a move gets its taker out of wherever they are, so everyone is
+    // only put back inside once all of the actions have been started.
+    for ( unsigned int i = 0; i < entities.size(); ++i )
+    {
+        Entity * entity( entities[i] );
+        const EntityRecord & record( records[i] );
+        if ( entity == 0 || ( record.flags & RECORD_RELEASED ) != 0 )
+        {
+            continue;
+        }
+
+        if ( record.container >= 0 &&
+             record.container < static_cast< int >( entities.size() ) &&
+             entities[record.container] != 0 )
+        {
+            Entity * holder( entities[record.container] );
+            if ( holder->getType() == TYPE_CAR )
+            {
+                static_cast< Car * >( holder )->enter( entity );
+            }
+            else if ( holder->getType() == TYPE_BUILDING )
+            {
+                static_cast< Building * >( holder )->getMeta()->enter( entity );
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+//private:
+//------------------------------------------------------------------------------
+unsigned int WINAPI
+SaveGame::s_run( void * data )
+{
+    static_cast< SaveGame * >( data )->_run();
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+void
+SaveGame::_run()
+{
+    std::vector< EntityRecord > records;
+    bool quit( false );
+
+    while ( ! quit )
+    {
+        WaitForSingleObject( m_wake, INFINITE );
+
+        EnterCriticalSection( & m_lock );
+        bool pending( m_pending );
+        if ( pending )
+        {
+            records.swap( m_queued );
+            m_pending = false;
+        }
+        quit = m_quit;
+        LeaveCriticalSection( & m_lock );
+
+        if ( pending )
+        {
+            _write( records );
+        }
+
+        EnterCriticalSection( & m_lock );
+        if ( ! m_pending )
+        {
+            SetEvent( m_idle );
+        }
+        LeaveCriticalSection( & m_lock );
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+SaveGame::_write( std::vector< EntityRecord > & records )
+{
+    if ( records.size() == 0 )
+    {
+        return;
+    }
+
+    bool keyframe( m_keyframe.size() != records.size() ||
+                   m_sequence - m_keysequence >= KEYFRAME_INTERVAL );
+
+    m_sequence += 1;
+
+    ChunkHeader header;
+    header.magic = SAVE_MAGIC;
+    header.version = SAVE_VERSION;
+    header.sequence = m_sequence;
+    header.count = records.size();
+
+    FILE * file( 0 );
+
+    if ( keyframe )
+    {
+        if ( fopen_s( & file, m_filename, "wb" ) != 0 )
+        {
+            return;
+        }
+        m_keysequence = m_sequence;
+        header.type = CHUNK_KEYFRAME;
+        header.keysequence = m_keysequence;
+        header.words = records.size() * RECORD_WORDS;
+        fwrite( & header, sizeof( ChunkHeader ), 1, file );
+        fwrite( & records[0], sizeof( EntityRecord ), records.size(), file );
+        m_keyframe.swap( records );
+    }
+    else
+    {
+        std::vector< unsigned int > words;
+        _encode( records, words );
+        if ( fopen_s( & file, m_filename, "ab" ) != 0 )
+        {
+            return;
+        }
+        header.type = CHUNK_DELTA;
+        header.keysequence = m_keysequence;
+        header.words = words.size();
+        fwrite( & header, sizeof( ChunkHeader ), 1, file );
+        if ( words.size() > 0 )
+        {
+            fwrite( & words[0], sizeof( unsigned int ), words.size(), file );
+        }
+    }
+
+    fclose( file );
+}
+
+//------------------------------------------------------------------------------
+// The newest delta for the newest keyframe wins. Sizes come from the file, so
+// they're checked against the world we expect before anything is allocated.
+bool
+SaveGame::_read( unsigned int count, std::vector< EntityRecord > & records )
+{
+    FILE * file( 0 );
+    if ( fopen_s( & file, m_filename, "rb" ) != 0 )
+    {
+        return false;
+    }
+
+    std::vector< EntityRecord > keyframe;
+    std::vector< unsigned int > words;
+    unsigned int keysequence( 0 );
+    bool found( false );
+
+    ChunkHeader header;
+    while ( fread( & header, sizeof( ChunkHeader ), 1, file ) == 1 )
+    {
+        if ( header.magic != SAVE_MAGIC || header.version != SAVE_VERSION )
+        {
+            Engine::hge()->System_Log( "Corrupt saved game" );
+            break;
+        }
+        if ( header.count != count ||
+             header.words > count * RECORD_WORDS * 2 )
+        {
+            Engine::hge()->System_Log( "Saved game doesn't match the world" );
+            break;
+        }
+        if ( header.type == CHUNK_KEYFRAME )
+        {
+            keyframe.resize( header.count );
+            if ( header.count > 0 &&
+                 fread( & keyframe[0], sizeof( EntityRecord ), header.count,
+                        file ) != header.count )
+            {
+                break;
+            }
+            keysequence = header.sequence;
+            records = keyframe;
+            found = true;
+        }
+        else
+        {
+            words.resize( header.words );
+            if ( header.words > 0 &&
+                 fread( & words[0], sizeof( unsigned int ), header.words,
+                        file ) != header.words )
+            {
+                break;
+            }
+            if ( header.keysequence != keysequence ||
+                 header.count != keyframe.size() )
+            {
+                continue;
+            }
+            records = keyframe;
+            if ( ! _decode( words, records ) )
+            {
+                records = keyframe;
+            }
+        }
+    }
+
+    fclose( file );
+
+    return found;
+}
+
+//------------------------------------------------------------------------------
+// Anything that gets turned back into an enum has to be one that we know, as
+// there's nothing sensible to be made of an action or allegiance that isn't.
+bool
+SaveGame::_validate( const std::vector< EntityRecord > & records )
+{
+    std::vector< EntityRecord >::const_iterator i;
+    for ( i = records.begin(); i != records.end(); ++i )
+    {
+        if ( ( i->flags & RECORD_RELEASED ) != 0 )
+        {
+            continue;
+        }
+        int allegiance( i->flags & RECORD_ALLEGIANCE );
+        if ( allegiance < ALLEGIANCE_UNKNOWN ||
+             allegiance > ALLEGIANCE_HOSTILE )
+        {
+            return false;
+        }
+        if ( i->action != TYPE_NONE &&
+             ( i->action < TYPE_MOVE || i->action > TYPE_AIRSTRIKE ) )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// Each run is a word holding the number of unchanged words in the low half and
+// the number of changed words in the high half, followed by the changed words
+// XORed against the keyframe.
+void
+SaveGame::_encode( const std::vector< EntityRecord > & records,
+                   std::vector< unsigned int > & words )
+{
+    const unsigned int * key(
+        reinterpret_cast< const unsigned int * >( & m_keyframe[0] ) );
+    const unsigned int * now(
+        reinterpret_cast< const unsigned int * >( & records[0] ) );
+    unsigned int size( records.size() * RECORD_WORDS );
+
+    words.clear();
+
+    unsigned int i( 0 );
+    while ( i < size )
+    {
+        unsigned int same( 0 );
+        while ( i < size && key[i] == now[i] && same < 0xFFFF )
+        {
+            ++same;
+            ++i;
+        }
+        unsigned int start( i );
+        while ( i < size && key[i] != now[i] && i - start < 0xFFFF )
+        {
+            ++i;
+        }
+        if ( i == start && i == size )
+        {
+            break;
+        }
+        words.push_back( same | ( ( i - start ) << 16 ) );
+        for ( unsigned int j = start; j < i; ++j )
+        {
+            words.push_back( key[j] ^ now[j] );
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+bool
+SaveGame::_decode( const std::vector< unsigned int > & words,
+                   std::vector< EntityRecord > & records )
+{
+    unsigned int * now( reinterpret_cast< unsigned int * >( & records[0] ) );
+    unsigned int size( records.size() * RECORD_WORDS );
+
+    unsigned int i( 0 );
+    unsigned int j( 0 );
+    while ( j < words.size() )
+    {
+        unsigned int same( words[j] & 0xFFFF );
+        unsigned int changed( words[j] >> 16 );
+        ++j;
+        i += same;
+        if ( i + changed > size || j + changed > words.size() )
+        {
+            return false;
+        }
+        for ( unsigned int k = 0; k < changed; ++k )
+        {
+            now[i++] ^= words[j++];
+        }
+    }
+
+    return true;
+}
+
+//==============================================================================
@@ -0,0 +1,85 @@
+//==============================================================================
+
+#ifndef ArseSave
+#define ArseSave
+
+#include <vector>
+
+#include <hge.h>
+
+class Entity;
+
+//------------------------------------------------------------------------------
+// The complete simulation state of one entity, stored by index into the
+// cached world. Records are plain words so that deltas can be taken with XOR.
+struct EntityRecord
+{
+    float x;
+    float y;
+    float angle;
+    float vx;
+    float vy;
+    float spin;
+    float strength;
+    float damage;
+    int flags;
+    int container;
+    int action;
+    int target;
+    float tx;
+    float ty;
+};
+
+//------------------------------------------------------------------------------
+// Mid-mission saves. The main thread captures the world into a vector of
+// records, which is handed to a writer thread. The writer stores a keyframe
+// every so often and, in between, appends a run-length encoded XOR delta
+// against that keyframe, so that frequent autosaves stay small and cheap.
+class SaveGame
+{
+  public:
+    SaveGame( const char * filename );
+    ~SaveGame();
+
+  private:
+    SaveGame( const SaveGame & );
+    SaveGame & operator=( const SaveGame & );
+
+  public:
+    void save( const std::vector< Entity * > & entities );
+    bool load( const std::vector< Entity * > & entities );
+    void flush();
+
+    static void capture( const std::vector< Entity * > & entities,
+                         std::vector< EntityRecord > & records );
+    static void apply( const std::vector< Entity * > & entities,
+                       const std::vector< EntityRecord > & records );
+
+  private:
+    static unsigned int WINAPI s_run( void * data );
+    void _run();
+    void _write( std::vector< EntityRecord > & records );
+    bool _read( unsigned int count, std::vector< EntityRecord > & records );
+    static bool _validate( const std::vector< EntityRecord > & records );
+    void _encode( const std::vector< EntityRecord > & records,
+                  std::vector< unsigned int > & words );
+    bool _decode( const std::vector< unsigned int > & words,
+                  std::vector< EntityRecord > & records );
+
+  private:
+    const char * m_filename;
+    HANDLE m_thread;
+    HANDLE m_wake;
+    HANDLE m_idle;
+    CRITICAL_SECTION m_lock;
+    bool m_quit;
+    bool m_pending;
+    std::vector< EntityRecord > m_queued;
+    std::vector< EntityRecord > m_keyframe;
+    unsigned int m_sequence;
+    unsigned int m_keysequence;
+};
+
+#endif
+
+//==============================================================================
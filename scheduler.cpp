@@ -0,0 +1,192 @@
+//==============================================================================
+
+#include <algorithm>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <entity.hpp>
+#include <scheduler.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const unsigned int DEFAULT_BUDGET( 500 );
+    const float AGE_WEIGHT( 500.0f );
+    const float LATENCY_SMOOTHING( 0.1f );
+
+    bool
+    later( const Scheduler::Request & left, const Scheduler::Request & right )
+    {
+        if ( left.key != right.key )
+        {
+            return left.key > right.key;
+        }
+        return left.index > right.index;
+    }
+};
+
+//------------------------------------------------------------------------------
+Scheduler::Scheduler()
+    :
+    m_queue(),
+    m_queued(),
+    m_budget( DEFAULT_BUDGET ),
+    m_frequency( 0 ),
+    m_start( 0 ),
+    m_decisions( 0 ),
+    m_latency( 0.0f ),
+    m_worst( 0.0f )
+{
+    LARGE_INTEGER count;
+    QueryPerformanceFrequency( & count );
+    m_frequency = count.QuadPart;
+    QueryPerformanceCounter( & count );
+    m_start = count.QuadPart;
+}
+
+//------------------------------------------------------------------------------
+Scheduler::~Scheduler()
+{
+}
+
+//------------------------------------------------------------------------------
+void
+Scheduler::clear()
+{
+    m_queue.clear();
+    m_queued.clear();
+    m_decisions = 0;
+    m_latency = 0.0f;
+    m_worst = 0.0f;
+}
+
+//------------------------------------------------------------------------------
+void
+Scheduler::request( Guy * guy, float priority )
+{
+    if ( ! m_queued.insert( guy->getHandle() ).second )
+    {
+        return;
+    }
+    LARGE_INTEGER count;
+    QueryPerformanceCounter( & count );
+
+    Request request;
+    request.key = priority + AGE_WEIGHT * _seconds( count.QuadPart - m_start );
+    request.index = guy->getIndex();
+    request.handle = guy->getHandle();
+    request.requested = count.QuadPart;
+    m_queue.push_back( request );
+    std::push_heap( m_queue.begin(), m_queue.end(), later );
+}
+
+//------------------------------------------------------------------------------
+// Makes decisions until the budget runs out, always making at least one so
+// that the queue can't stall. Those who decided are handed back so that the
+// replay can record them.
+void
+Scheduler::run( std::vector< Guy * > & decided )
+{
+    decided.clear();
+    m_decisions = 0;
+    m_worst = 0.0f;
+
+    LARGE_INTEGER count;
+    QueryPerformanceCounter( & count );
+    LONGLONG begin( count.QuadPart );
+    LONGLONG budget( m_frequency * m_budget / 1000000 );
+
+    while ( m_queue.size() > 0 )
+    {
+        if ( m_decisions > 0 && count.QuadPart - begin >= budget )
+        {
+            break;
+        }
+
+        std::pop_heap( m_queue.begin(), m_queue.end(), later );
+        Request request( m_queue.back() );
+        m_queue.pop_back();
+        m_queued.erase( request.handle );
+
+        Entity * entity( Entity::lookup( request.handle ) );
+        if ( entity != 0 && entity->getType() == TYPE_GUY )
+        {
+            Guy * guy( static_cast< Guy * >( entity ) );
+            if ( guy->needsDecision() )
+            {
+                guy->decide();
+                decided.push_back( guy );
+                m_decisions += 1;
+
+                float latency( 1000.0f *
+                               _seconds( count.QuadPart - request.requested ) );
+                m_latency += LATENCY_SMOOTHING * ( latency - m_latency );
+                if ( latency > m_worst )
+                {
+                    m_worst = latency;
+                }
+            }
+        }
+
+        QueryPerformanceCounter( & count );
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+Scheduler::setBudget( unsigned int microseconds )
+{
+    m_budget = microseconds;
+}
+
+//------------------------------------------------------------------------------
+unsigned int
+Scheduler::getBudget()
+{
+    return m_budget;
+}
+
+//------------------------------------------------------------------------------
+int
+Scheduler::getDepth()
+{
+    return static_cast< int >( m_queue.size() );
+}
+
+//------------------------------------------------------------------------------
+int
+Scheduler::getDecisions()
+{
+    return m_decisions;
+}
+
+//------------------------------------------------------------------------------
+// How long requests have been waiting, in milliseconds, smoothed over recent
+// decisions.
+float
+Scheduler::getLatency()
+{
+    return m_latency;
+}
+
+//------------------------------------------------------------------------------
+// The longest wait of any decision made in the last run, in milliseconds.
+float
+Scheduler::getWorstLatency()
+{
+    return m_worst;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+float
+Scheduler::_seconds( LONGLONG ticks )
+{
+    return static_cast< float >( static_cast< double >( ticks ) /
+                                 static_cast< double >( m_frequency ) );
+}
+
+//==============================================================================
@@ -0,0 +1,71 @@
+//==============================================================================
+
+#ifndef ArseScheduler
+#define ArseScheduler
+
+#include <vector>
+#include <set>
+
+#include <hge.h>
+
+#include <handles.hpp>
+
+class Guy;
+
+//------------------------------------------------------------------------------
+// Decisions for idle civilians are queued rather than made on the spot, and a
+// few are made each frame until a budget of wall-clock time has been spent, so
+// that a crowd finishing their moves together doesn't cost one frame dearly.
+// Requests carry a priority, lower first, which the caller works out from how
+// close and how visible the entity is; the time a request was made is added
+// on top, so that anything left waiting long enough comes to the front. Each
+// entity is only ever queued once, and is checked again when its turn comes
+// in case it has been given something to do in the meantime.
+class Scheduler
+{
+  public:
+    Scheduler();
+    ~Scheduler();
+
+  private:
+    Scheduler( const Scheduler & );
+    Scheduler & operator=( const Scheduler & );
+
+  public:
+    struct Request
+    {
+        float key;
+        int index;
+        EntityHandle handle;
+        LONGLONG requested;
+    };
+
+  public:
+    void clear();
+    void request( Guy * guy, float priority );
+    void run( std::vector< Guy * > & decided );
+
+    void setBudget( unsigned int microseconds );
+    unsigned int getBudget();
+    int getDepth();
+    int getDecisions();
+    float getLatency();
+    float getWorstLatency();
+
+  private:
+    float _seconds( LONGLONG ticks );
+
+  private:
+    std::vector< Request > m_queue;
+    std::set< EntityHandle > m_queued;
+    unsigned int m_budget;
+    LONGLONG m_frequency;
+    LONGLONG m_start;
+    int m_decisions;
+    float m_latency;
+    float m_worst;
+};
+
+#endif
+
+//==============================================================================
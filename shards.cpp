@@ -0,0 +1,456 @@
+//==============================================================================
+
+#include <algorithm>
+#include <process.h>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <shards.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const float WORLD_MARGIN( 100.0f );
+    const float MIGRATE_MARGIN( 5.0f );
+    const int QUERY_LIMIT( 256 );
+
+    inline b2AABB
+    expand( const b2AABB & aabb, float margin )
+    {
+        b2AABB result;
+        result.lowerBound.Set( aabb.lowerBound.x - margin,
+                               aabb.lowerBound.y - margin );
+        result.upperBound.Set( aabb.upperBound.x + margin,
+                               aabb.upperBound.y + margin );
+        return result;
+    }
+
+    inline bool
+    overlaps( const b2AABB & a, const b2AABB & b )
+    {
+        return a.lowerBound.x <= b.upperBound.x &&
+               b.lowerBound.x <= a.upperBound.x &&
+               a.lowerBound.y <= b.upperBound.y &&
+               b.lowerBound.y <= a.upperBound.y;
+    }
+
+    inline bool
+    contains( const b2AABB & aabb, const b2Vec2 & point )
+    {
+        return point.x >= aabb.lowerBound.x && point.x <= aabb.upperBound.x &&
+               point.y >= aabb.lowerBound.y && point.y <= aabb.upperBound.y;
+    }
+
+    inline void
+    copyFilter( b2Shape * shape, b2ShapeDef & shapeDef )
+    {
+        shapeDef.userData = shape->GetUserData();
+        shapeDef.friction = shape->GetFriction();
+        shapeDef.restitution = shape->GetRestitution();
+        shapeDef.categoryBits = shape->m_categoryBits;
+        shapeDef.maskBits = shape->m_maskBits;
+        shapeDef.groupIndex = shape->m_groupIndex;
+    }
+};
+
+//------------------------------------------------------------------------------
+ShardedWorld::Listener::Listener()
+    :
+    b2ContactListener(),
+    contacts()
+{
+}
+
+//------------------------------------------------------------------------------
+// Called on whichever worker is stepping the shard, so all we do is make a
+// note of it.
+void
+ShardedWorld::Listener::Add( b2ContactPoint * point )
+{
+    ShardContact contact;
+    contact.first = point->shape1->GetBody()->GetUserData();
+    contact.second = point->shape2->GetBody()->GetUserData();
+    contact.position = point->position;
+    contact.normalForce = point->normalForce;
+    contacts.push_back( contact );
+}
+
+//------------------------------------------------------------------------------
+// With no threads the tiles are stepped in turn by whoever calls step().
+// Box2D sets up its contact tables the first time a world is stepped, so one
+// world should have been stepped on the main thread before any workers are.
+ShardedWorld::ShardedWorld( const b2AABB & bounds, int columns, int rows,
+                            int threads )
+    :
+    m_shards(),
+    m_bodies(),
+    m_workers(),
+    m_columns( columns > 0 ? columns : 1 ),
+    m_rows( rows > 0 ? rows : 1 ),
+    m_bounds( bounds ),
+    m_dt( 0.0f ),
+    m_iterations( 0 ),
+    m_quit( false ),
+    m_migrations( 0 )
+{
+    b2Vec2 size( ( bounds.upperBound.x - bounds.lowerBound.x ) / m_columns,
+                 ( bounds.upperBound.y - bounds.lowerBound.y ) / m_rows );
+    b2Vec2 gravity( 0.0f, 0.0f );
+    for ( int y = 0; y < m_rows; ++y )
+    {
+        for ( int x = 0; x < m_columns; ++x )
+        {
+            Shard * shard( new Shard() );
+            shard->tile.lowerBound.Set( bounds.lowerBound.x + x * size.x,
+                                        bounds.lowerBound.y + y * size.y );
+            shard->tile.upperBound = shard->tile.lowerBound + size;
+            shard->world = new b2World( expand( shard->tile, WORLD_MARGIN ),
+                                        gravity, true );
+            shard->world->SetListener(
+                static_cast< b2ContactListener * >( & shard->listener ) );
+            m_shards.push_back( shard );
+        }
+    }
+
+    int count( std::min( threads, static_cast< int >( m_shards.size() ) ) );
+    if ( count < 2 )
+    {
+        return;
+    }
+    m_workers.reserve( count );
+    for ( int i = 0; i < count; ++i )
+    {
+        Worker worker;
+        worker.owner = this;
+        worker.index = i;
+        worker.wake = CreateEvent( NULL, FALSE, FALSE, NULL );
+        worker.done = CreateEvent( NULL, FALSE, FALSE, NULL );
+        worker.thread = 0;
+        m_workers.push_back( worker );
+    }
+    for ( int i = 0; i < count; ++i )
+    {
+        m_workers[i].thread = reinterpret_cast< HANDLE >(
+            _beginthreadex( NULL, 0, s_run, & m_workers[i], 0, NULL ) );
+    }
+}
+
+//------------------------------------------------------------------------------
+ShardedWorld::~ShardedWorld()
+{
+    m_quit = true;
+    std::vector< Worker >::iterator i;
+    for ( i = m_workers.begin(); i != m_workers.end(); ++i )
+    {
+        SetEvent( i->wake );
+        WaitForSingleObject( i->thread, INFINITE );
+        CloseHandle( i->thread );
+        CloseHandle( i->wake );
+        CloseHandle( i->done );
+    }
+    m_workers.clear();
+
+    while ( m_shards.size() > 0 )
+    {
+        delete m_shards.back()->world;
+        delete m_shards.back();
+        m_shards.pop_back();
+    }
+}
+
+//------------------------------------------------------------------------------
+// Copies the static bodies of an existing world into every tile that they
+// overlap, keeping their user data so that queries can tell the copies apart.
+void
+ShardedWorld::addStatic( b2World * world )
+{
+    for ( b2Body * body = world->GetBodyList(); body != 0;
+          body = body->GetNext() )
+    {
+        if ( ! body->IsStatic() || body->GetUserData() == 0 )
+        {
+            continue;
+        }
+        std::vector< Shard * >::iterator i;
+        for ( i = m_shards.begin(); i != m_shards.end(); ++i )
+        {
+            b2AABB bounds( expand( ( * i )->tile, WORLD_MARGIN ) );
+            b2Body * copy( 0 );
+            for ( b2Shape * shape = body->GetShapeList(); shape != 0;
+                  shape = shape->GetNext() )
+            {
+                b2AABB aabb;
+                shape->ComputeAABB( & aabb, body->GetXForm() );
+                if ( ! overlaps( aabb, bounds ) )
+                {
+                    continue;
+                }
+                if ( copy == 0 )
+                {
+                    b2BodyDef bodyDef;
+                    bodyDef.userData = body->GetUserData();
+                    bodyDef.position = body->GetPosition();
+                    bodyDef.angle = body->GetAngle();
+                    copy = ( * i )->world->CreateStaticBody( & bodyDef );
+                }
+                if ( shape->GetType() == e_circleShape )
+                {
+                    b2CircleShape * circle(
+                        static_cast< b2CircleShape * >( shape ) );
+                    b2CircleDef shapeDef;
+                    copyFilter( shape, shapeDef );
+                    shapeDef.localPosition = circle->GetLocalPosition();
+                    shapeDef.radius = circle->GetRadius();
+                    copy->CreateShape( & shapeDef );
+                }
+                else if ( shape->GetType() == e_polygonShape )
+                {
+                    b2PolygonShape * polygon(
+                        static_cast< b2PolygonShape * >( shape ) );
+                    b2PolygonDef shapeDef;
+                    copyFilter( shape, shapeDef );
+                    shapeDef.vertexCount = polygon->GetVertexCount();
+                    for ( int j = 0; j < shapeDef.vertexCount; ++j )
+                    {
+                        shapeDef.vertices[j] = polygon->GetVertices()[j];
+                    }
+                    copy->CreateShape( & shapeDef );
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+int
+ShardedWorld::addBody( const b2BodyDef & bodyDef,
+                       const b2CircleDef & shapeDef )
+{
+    Body body;
+    body.bodyDef = bodyDef;
+    body.shapeDef = shapeDef;
+    body.shard = _shardAt( bodyDef.position );
+    body.body = _create( body );
+    m_bodies.push_back( body );
+    return static_cast< int >( m_bodies.size() ) - 1;
+}
+
+//------------------------------------------------------------------------------
+// Bodies can be recreated when they change tiles, so hang on to the handle
+// rather than the body.
+b2Body *
+ShardedWorld::getBody( int handle )
+{
+    return m_bodies[handle].body;
+}
+
+//------------------------------------------------------------------------------
+void
+ShardedWorld::step( float dt, int iterations )
+{
+    m_dt = dt;
+    m_iterations = iterations;
+
+    if ( m_workers.size() == 0 )
+    {
+        _stepShards( 0, 1 );
+    }
+    else
+    {
+        std::vector< Worker >::iterator i;
+        for ( i = m_workers.begin(); i != m_workers.end(); ++i )
+        {
+            SetEvent( i->wake );
+        }
+        for ( i = m_workers.begin(); i != m_workers.end(); ++i )
+        {
+            WaitForSingleObject( i->done, INFINITE );
+        }
+    }
+
+    _migrate();
+}
+
+//------------------------------------------------------------------------------
+// Finds the user data of everything within the area, across every tile that
+// it touches. Static bodies may have been copied into several tiles, so the
+// result is sorted and duplicates are removed.
+int
+ShardedWorld::query( const b2AABB & aabb, std::vector< void * > & found )
+{
+    found.clear();
+    b2Shape * shapes[QUERY_LIMIT];
+    std::vector< Shard * >::iterator i;
+    for ( i = m_shards.begin(); i != m_shards.end(); ++i )
+    {
+        if ( ! overlaps( aabb, expand( ( * i )->tile, WORLD_MARGIN ) ) )
+        {
+            continue;
+        }
+        int num( ( * i )->world->Query( aabb, shapes, QUERY_LIMIT ) );
+        for ( int j = 0; j < num; ++j )
+        {
+            void * data( shapes[j]->GetBody()->GetUserData() );
+            if ( data != 0 )
+            {
+                found.push_back( data );
+            }
+        }
+    }
+    std::sort( found.begin(), found.end() );
+    found.erase( std::unique( found.begin(), found.end() ), found.end() );
+    return static_cast< int >( found.size() );
+}
+
+//------------------------------------------------------------------------------
+// The contacts that began during the last step, from every tile.
+void
+ShardedWorld::getContacts( std::vector< ShardContact > & contacts )
+{
+    contacts.clear();
+    std::vector< Shard * >::iterator i;
+    for ( i = m_shards.begin(); i != m_shards.end(); ++i )
+    {
+        const std::vector< ShardContact > & buffered(
+            ( * i )->listener.contacts );
+        contacts.insert( contacts.end(), buffered.begin(), buffered.end() );
+    }
+}
+
+//------------------------------------------------------------------------------
+int
+ShardedWorld::getNumShards()
+{
+    return static_cast< int >( m_shards.size() );
+}
+
+//------------------------------------------------------------------------------
+int
+ShardedWorld::getNumThreads()
+{
+    return static_cast< int >( m_workers.size() );
+}
+
+//------------------------------------------------------------------------------
+int
+ShardedWorld::getMigrations()
+{
+    return m_migrations;
+}
+
+//------------------------------------------------------------------------------
+int
+ShardedWorld::getProxyCount()
+{
+    int count( 0 );
+    std::vector< Shard * >::iterator i;
+    for ( i = m_shards.begin(); i != m_shards.end(); ++i )
+    {
+        count += ( * i )->world->GetProxyCount();
+    }
+    return count;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+unsigned int WINAPI
+ShardedWorld::s_run( void * data )
+{
+    Worker * worker( static_cast< Worker * >( data ) );
+    worker->owner->_run( * worker );
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+// Each worker looks after every n-th tile, so the tiles are never shared and
+// no locking is needed; the events are all the synchronisation there is.
+void
+ShardedWorld::_run( Worker & worker )
+{
+    while ( true )
+    {
+        WaitForSingleObject( worker.wake, INFINITE );
+        if ( m_quit )
+        {
+            break;
+        }
+        _stepShards( worker.index, static_cast< int >( m_workers.size() ) );
+        SetEvent( worker.done );
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+ShardedWorld::_stepShards( int first, int stride )
+{
+    for ( unsigned int i = first; i < m_shards.size(); i += stride )
+    {
+        m_shards[i]->listener.contacts.clear();
+        m_shards[i]->world->Step( m_dt, m_iterations );
+    }
+}
+
+//------------------------------------------------------------------------------
+int
+ShardedWorld::_shardAt( const b2Vec2 & point )
+{
+    float width( m_bounds.upperBound.x - m_bounds.lowerBound.x );
+    float height( m_bounds.upperBound.y - m_bounds.lowerBound.y );
+    int x( static_cast< int >( ( point.x - m_bounds.lowerBound.x ) *
+                               m_columns / width ) );
+    int y( static_cast< int >( ( point.y - m_bounds.lowerBound.y ) *
+                               m_rows / height ) );
+    x = x < 0 ? 0 : ( x >= m_columns ? m_columns - 1 : x );
+    y = y < 0 ? 0 : ( y >= m_rows ? m_rows - 1 : y );
+    return y * m_columns + x;
+}
+
+//------------------------------------------------------------------------------
+b2Body *
+ShardedWorld::_create( Body & body )
+{
+    b2World * world( m_shards[body.shard]->world );
+    b2Body * created( world->CreateDynamicBody( & body.bodyDef ) );
+    created->CreateShape( & body.shapeDef );
+    created->SetMassFromShapes();
+    return created;
+}
+
+//------------------------------------------------------------------------------
+// Bodies that have wandered a little way past the edge of their tile are made
+// again in the tile they're now in, moving as they were. The slack stops them
+// from bouncing back and forth along a border.
+void
+ShardedWorld::_migrate()
+{
+    std::vector< Body >::iterator i;
+    for ( i = m_bodies.begin(); i != m_bodies.end(); ++i )
+    {
+        b2Vec2 position( i->body->GetPosition() );
+        if ( contains( expand( m_shards[i->shard]->tile, MIGRATE_MARGIN ),
+                       position ) )
+        {
+            continue;
+        }
+        int shard( _shardAt( position ) );
+        if ( shard == i->shard )
+        {
+            continue;
+        }
+        b2Vec2 velocity( i->body->GetLinearVelocity() );
+        float spin( i->body->GetAngularVelocity() );
+        i->bodyDef.position = position;
+        i->bodyDef.angle = i->body->GetAngle();
+        m_shards[i->shard]->world->DestroyBody( i->body );
+        i->shard = shard;
+        i->body = _create( * i );
+        i->body->SetLinearVelocity( velocity );
+        i->body->SetAngularVelocity( spin );
+        m_migrations += 1;
+    }
+}
+
+//==============================================================================
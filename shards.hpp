@@ -0,0 +1,110 @@
+//==============================================================================
+
+#ifndef ArseShards
+#define ArseShards
+
+#include <vector>
+
+#include <hge.h>
+#include <Box2D.h>
+
+//------------------------------------------------------------------------------
+// Physics for crowds too big for one world, split over a grid of tiles that
+// each have a b2World of their own and are stepped on worker threads. Static
+// geometry is copied into every tile it overlaps, while moving bodies live in
+// exactly one tile and are moved to the next when they cross its border.
+// Queries are sent to every tile they touch, and contacts are buffered while
+// the tiles step so that they can be dealt with on the main thread.
+//
+// Bodies in neighbouring tiles don't collide with one another, so this suits
+// crowds better than it does the cars and buildings of the mission itself.
+// With a single tile and no threads it's an ordinary world, which is what the
+// benchmark compares against.
+class ShardedWorld
+{
+  public:
+    ShardedWorld( const b2AABB & bounds, int columns, int rows, int threads );
+    ~ShardedWorld();
+
+  private:
+    ShardedWorld( const ShardedWorld & );
+    ShardedWorld & operator=( const ShardedWorld & );
+
+  public:
+    struct ShardContact
+    {
+        void * first;
+        void * second;
+        b2Vec2 position;
+        float normalForce;
+    };
+
+  private:
+    class Listener : public b2ContactListener
+    {
+      public:
+        Listener();
+        virtual void Add( b2ContactPoint * point );
+        std::vector< ShardContact > contacts;
+    };
+
+    struct Shard
+    {
+        b2World * world;
+        b2AABB tile;
+        Listener listener;
+    };
+
+    struct Body
+    {
+        int shard;
+        b2Body * body;
+        b2BodyDef bodyDef;
+        b2CircleDef shapeDef;
+    };
+
+    struct Worker
+    {
+        ShardedWorld * owner;
+        int index;
+        HANDLE thread;
+        HANDLE wake;
+        HANDLE done;
+    };
+
+  public:
+    void addStatic( b2World * world );
+    int addBody( const b2BodyDef & bodyDef, const b2CircleDef & shapeDef );
+    b2Body * getBody( int handle );
+    void step( float dt, int iterations );
+    int query( const b2AABB & aabb, std::vector< void * > & found );
+    void getContacts( std::vector< ShardContact > & contacts );
+    int getNumShards();
+    int getNumThreads();
+    int getMigrations();
+    int getProxyCount();
+
+  private:
+    static unsigned int WINAPI s_run( void * data );
+    void _run( Worker & worker );
+    void _stepShards( int first, int stride );
+    int _shardAt( const b2Vec2 & point );
+    b2Body * _create( Body & body );
+    void _migrate();
+
+  private:
+    std::vector< Shard * > m_shards;
+    std::vector< Body > m_bodies;
+    std::vector< Worker > m_workers;
+    int m_columns;
+    int m_rows;
+    b2AABB m_bounds;
+    float m_dt;
+    int m_iterations;
+    bool m_quit;
+    int m_migrations;
+};
+
+#endif
+
+//==============================================================================
@@ -1,13 +1,13 @@
-//==============================================================================
-
-#include <engine.hpp>
-
-//------------------------------------------------------------------------------
-int
-WINAPI WinMain( HINSTANCE, HINSTANCE, LPSTR, int )
-{
-    Engine::instance()->start();
-    return 0;
-}
-
-//==============================================================================
+//==============================================================================
+
+#include <engine.hpp>
+
+//------------------------------------------------------------------------------
+int
+WINAPI WinMain( HINSTANCE, HINSTANCE, LPSTR, int )
+{
+    Engine::instance()->start();
+    return 0;
+}
+
+//==============================================================================
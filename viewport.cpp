@@ -1,92 +1,206 @@
-//==============================================================================
-
-#include <viewport.hpp>
-
-//------------------------------------------------------------------------------
-ViewPort::ViewPort()
-    :
-    m_offset(),
-    m_bounds(),
-    m_screen(),
-    m_hscale( 0.0f ),
-    m_vscale( 0.0f ),
-    m_angle( 0.0f )
-{
-}
-
-//------------------------------------------------------------------------------
-ViewPort::~ViewPort()
-{
-}
-
-//------------------------------------------------------------------------------
-float
-ViewPort::angle()
-{
-    return m_angle;
-}
-
-//------------------------------------------------------------------------------
-b2Vec2 &
-ViewPort::offset()
-{
-    return m_offset;
-}
-
-//------------------------------------------------------------------------------
-b2Vec2 &
-ViewPort::bounds()
-{
-    return m_bounds;
-}
-
-//------------------------------------------------------------------------------
-b2Vec2 &
-ViewPort::screen()
-{
-    return m_screen;
-}
-
-//------------------------------------------------------------------------------
-void
-ViewPort::screenToWorld( b2Vec2 & point )
-{
-    _updateRatios();
-    point.x = 400.0f - m_offset.x - 0.5f * m_bounds.x + point.x / m_hscale;
-    point.y = 300.0f - m_offset.y - 0.5f * m_bounds.y + point.y / m_vscale;
-}
-
-//------------------------------------------------------------------------------
-float
-ViewPort::hscale() const
-{
-    _updateRatios();
-    return m_hscale;
-}
-
-//------------------------------------------------------------------------------
-float
-ViewPort::vscale() const
-{
-    _updateRatios();
-    return m_vscale;
-}
-
-//------------------------------------------------------------------------------
-void
-ViewPort::setAngle( float angle )
-{
-    m_angle = angle;
-}
-
-//------------------------------------------------------------------------------
-// private:
-//------------------------------------------------------------------------------
-void
-ViewPort::_updateRatios() const
-{
-    m_hscale = m_screen.x / m_bounds.x;
-    m_vscale = m_screen.y / m_bounds.y;
-}
-
-//==============================================================================
+//==============================================================================
+
+#include <hge.h>
+
+#include <viewport.hpp>
+
+//------------------------------------------------------------------------------
+ViewPort::ViewPort()
+    :
+    m_offset(),
+    m_bounds(),
+    m_screen(),
+    m_hscale( 0.0f ),
+    m_vscale( 0.0f ),
+    m_hinverse( 0.0f ),
+    m_vinverse( 0.0f ),
+    m_origin( 0.0f, 0.0f ),
+    m_dirty( true ),
+    m_angle( 0.0f )
+{
+}
+
+//------------------------------------------------------------------------------
+ViewPort::~ViewPort()
+{
+}
+
+//------------------------------------------------------------------------------
+float
+ViewPort::angle() const
+{
+    return m_angle;
+}
+
+//------------------------------------------------------------------------------
+const b2Vec2 &
+ViewPort::offset() const
+{
+    return m_offset;
+}
+
+//------------------------------------------------------------------------------
+const b2Vec2 &
+ViewPort::bounds() const
+{
+    return m_bounds;
+}
+
+//------------------------------------------------------------------------------
+const b2Vec2 &
+ViewPort::screen() const
+{
+    return m_screen;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::screenToWorld( b2Vec2 & point )
+{
+    _updateRatios();
+    point.x = m_origin.x + point.x * m_hinverse;
+    point.y = m_origin.y + point.y * m_vinverse;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::screenToWorld( b2Vec2 * points, int count )
+{
+    _updateRatios();
+    for ( int i = 0; i < count; ++i )
+    {
+        points[i].x = m_origin.x + points[i].x * m_hinverse;
+        points[i].y = m_origin.y + points[i].y * m_vinverse;
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::worldToScreen( b2Vec2 & point )
+{
+    _updateRatios();
+    point.x = ( point.x - m_origin.x ) * m_hscale;
+    point.y = ( point.y - m_origin.y ) * m_vscale;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::worldToScreen( b2Vec2 * points, int count )
+{
+    _updateRatios();
+    for ( int i = 0; i < count; ++i )
+    {
+        points[i].x = ( points[i].x - m_origin.x ) * m_hscale;
+        points[i].y = ( points[i].y - m_origin.y ) * m_vscale;
+    }
+}
+
+//------------------------------------------------------------------------------
+// The area of the world that's on screen. With the view rotated we don't try
+// to be clever, and the whole world is in view.
+void
+ViewPort::getView( b2AABB & view )
+{
+    if ( m_angle != 0.0f )
+    {
+        view.lowerBound.Set( -2500.0f, -2500.0f );
+        view.upperBound.Set( 2500.0f, 2500.0f );
+        return;
+    }
+    b2Vec2 corners[2] = { b2Vec2( 0.0f, 0.0f ), m_screen };
+    screenToWorld( corners, 2 );
+    view.lowerBound = corners[0];
+    view.upperBound = corners[1];
+}
+
+//------------------------------------------------------------------------------
+// Sets up HGE to draw in world coordinates.
+void
+ViewPort::apply( HGE * hge )
+{
+    _updateRatios();
+    hge->Gfx_SetTransform( 400.0f,
+                           300.0f,
+                           m_offset.x * m_hscale,
+                           m_offset.y * m_vscale,
+                           m_angle,
+                           m_hscale,
+                           m_vscale );
+}
+
+//------------------------------------------------------------------------------
+float
+ViewPort::hscale() const
+{
+    _updateRatios();
+    return m_hscale;
+}
+
+//------------------------------------------------------------------------------
+float
+ViewPort::vscale() const
+{
+    _updateRatios();
+    return m_vscale;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::setAngle( float angle )
+{
+    m_angle = angle;
+    m_dirty = true;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::setOffset( const b2Vec2 & offset )
+{
+    m_offset = offset;
+    m_dirty = true;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::moveOffset( const b2Vec2 & delta )
+{
+    m_offset += delta;
+    m_dirty = true;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::setBounds( const b2Vec2 & bounds )
+{
+    m_bounds = bounds;
+    m_dirty = true;
+}
+
+//------------------------------------------------------------------------------
+void
+ViewPort::setScreen( const b2Vec2 & screen )
+{
+    m_screen = screen;
+    m_dirty = true;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+void
+ViewPort::_updateRatios() const
+{
+    if ( ! m_dirty )
+    {
+        return;
+    }
+    m_hscale = m_screen.x / m_bounds.x;
+    m_vscale = m_screen.y / m_bounds.y;
+    m_hinverse = m_bounds.x / m_screen.x;
+    m_vinverse = m_bounds.y / m_screen.y;
+    m_origin.Set( 400.0f - m_offset.x - 0.5f * m_bounds.x,
+                  300.0f - m_offset.y - 0.5f * m_bounds.y );
+    m_dirty = false;
+}
+
+//==============================================================================
@@ -1,36 +1,55 @@
-//==============================================================================
-
-#ifndef ArseView
-#define ArseView
-
-#include <Box2D.h>
-
-//------------------------------------------------------------------------------
-class ViewPort
-{
-  public:
-    ViewPort();
-    ~ViewPort();
-    float angle();
-    b2Vec2 & offset();
-    b2Vec2 & bounds();
-    b2Vec2 & screen();
-    void screenToWorld( b2Vec2 & point );
-    float hscale() const;
-    float vscale() const;
-    void setAngle( float angle );
-
-  private:
-    void _updateRatios() const;
-
-    b2Vec2 m_offset;
-    b2Vec2 m_bounds;
-    b2Vec2 m_screen;
-    mutable float m_hscale;
-    mutable float m_vscale;
-    float m_angle;
-};
-
-#endif
-
-//==============================================================================
+//==============================================================================
+
+#ifndef ArseView
+#define ArseView
+
+#include <Box2D.h>
+
+class HGE;
+
+//------------------------------------------------------------------------------
+// The scales and the origin that map between the world and the screen are
+// kept, and only worked out again after something that they depend on has
+// changed, so the offset, bounds and screen may only be written through their
+// setters.
+class ViewPort
+{
+  public:
+    ViewPort();
+    ~ViewPort();
+    float angle() const;
+    const b2Vec2 & offset() const;
+    const b2Vec2 & bounds() const;
+    const b2Vec2 & screen() const;
+    void screenToWorld( b2Vec2 & point );
+    void screenToWorld( b2Vec2 * points, int count );
+    void worldToScreen( b2Vec2 & point );
+    void worldToScreen( b2Vec2 * points, int count );
+    void getView( b2AABB & view );
+    void apply( HGE * hge );
+    float hscale() const;
+    float vscale() const;
+    void setAngle( float angle );
+    void setOffset( const b2Vec2 & offset );
+    void moveOffset( const b2Vec2 & delta );
+    void setBounds( const b2Vec2 & bounds );
+    void setScreen( const b2Vec2 & screen );
+
+  private:
+    void _updateRatios() const;
+
+    b2Vec2 m_offset;
+    b2Vec2 m_bounds;
+    b2Vec2 m_screen;
+    mutable float m_hscale;
+    mutable float m_vscale;
+    mutable float m_hinverse;
+    mutable float m_vinverse;
+    mutable b2Vec2 m_origin;
+    mutable bool m_dirty;
+    float m_angle;
+};
+
+#endif
+
+//==============================================================================
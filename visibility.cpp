@@ -0,0 +1,529 @@
+//==============================================================================
+
+#include <algorithm>
+
+#include <hge.h>
+#include <Box2D.h>
+
+#include <visibility.hpp>
+#include <entity.hpp>
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+    const float WORLD_MIN( -2500.0f );
+    const float CELL_SIZE( 20.0f );
+    const int GRID_WIDTH( 250 );
+    const int GRID_HEIGHT( 250 );
+    const int SIGHT_RANGE( 15 );
+    const float RECAST_DISTANCE( 10.0f );
+
+    // Maps the first octant onto each of the eight in turn.
+    const int OCTANT[4][8] =
+    {
+        { 1, 0, 0, -1, -1, 0, 0, 1 },
+        { 0, 1, -1, 0, 0, -1, 1, 0 },
+        { 0, 1, 1, 0, 0, -1, -1, 0 },
+        { 1, 0, 0, 1, -1, 0, 0, -1 }
+    };
+};
+
+//------------------------------------------------------------------------------
+Visibility::Visibility()
+    :
+    m_opaque( GRID_WIDTH * GRID_HEIGHT, 0 ),
+    m_seen( GRID_WIDTH * GRID_HEIGHT, 0 ),
+    m_stamp( GRID_WIDTH * GRID_HEIGHT, 0 ),
+    m_generation( 0 ),
+    m_observers(),
+    m_bits(),
+    m_changed( true ),
+    m_left( 0 ),
+    m_top( 0 ),
+    m_right( GRID_WIDTH - 1 ),
+    m_bottom( GRID_HEIGHT - 1 )
+{
+}
+
+//------------------------------------------------------------------------------
+Visibility::~Visibility()
+{
+}
+
+//------------------------------------------------------------------------------
+// Only buildings block the view; cars, trees and people are all things that
+// we want to be able to see past.
+void
+Visibility::bake( const std::vector< Building * > & buildings )
+{
+    clear();
+
+    std::vector< Building * >::const_iterator i;
+    for ( i = buildings.begin(); i != buildings.end(); ++i )
+    {
+        // Buildings in a fused block share their owner's body, so it only
+        // needs rasterising once.
+        b2Body * body( ( * i )->getBody() );
+        if ( body->GetUserData() != static_cast< void * >( * i ) )
+        {
+            continue;
+        }
+        const b2XForm & xform( body->GetXForm() );
+        for ( b2Shape * shape = body->GetShapeList(); shape != 0;
+              shape = shape->GetNext() )
+        {
+            b2AABB aabb;
+            shape->ComputeAABB( & aabb, xform );
+            int x0( static_cast< int >(
+                ( aabb.lowerBound.x - WORLD_MIN ) / CELL_SIZE ) );
+            int y0( static_cast< int >(
+                ( aabb.lowerBound.y - WORLD_MIN ) / CELL_SIZE ) );
+            int x1( static_cast< int >(
+                ( aabb.upperBound.x - WORLD_MIN ) / CELL_SIZE ) );
+            int y1( static_cast< int >(
+                ( aabb.upperBound.y - WORLD_MIN ) / CELL_SIZE ) );
+            x0 = x0 < 0 ? 0 : x0;
+            y0 = y0 < 0 ? 0 : y0;
+            x1 = x1 >= GRID_WIDTH ? GRID_WIDTH - 1 : x1;
+            y1 = y1 >= GRID_HEIGHT ? GRID_HEIGHT - 1 : y1;
+            for ( int y = y0; y <= y1; ++y )
+            {
+                for ( int x = x0; x <= x1; ++x )
+                {
+                    b2Vec2 centre( WORLD_MIN + ( x + 0.5f ) * CELL_SIZE,
+                                   WORLD_MIN + ( y + 0.5f ) * CELL_SIZE );
+                    if ( shape->TestPoint( xform, centre ) )
+                    {
+                        m_opaque[y * GRID_WIDTH + x] = 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+Visibility::clear()
+{
+    std::fill( m_opaque.begin(), m_opaque.end(), 0 );
+    std::fill( m_seen.begin(), m_seen.end(), 0 );
+    m_observers.clear();
+    m_bits.clear();
+    m_changed = true;
+    m_left = 0;
+    m_top = 0;
+    m_right = GRID_WIDTH - 1;
+    m_bottom = GRID_HEIGHT - 1;
+}
+
+//------------------------------------------------------------------------------
+// Observers are recast only once they've moved far enough to matter, and the
+// bits for things that never move are only worked out again when a recast has
+// changed what can be seen.
+void
+Visibility::update( const std::vector< Guy * > & observers,
+                    const std::vector< Entity * > & entities )
+{
+    // When the squad changes, observers no longer line up with who they were,
+    // so everyone takes back what they saw and looks again.
+    if ( m_observers.size() != observers.size() )
+    {
+        std::vector< Observer >::iterator i;
+        for ( i = m_observers.begin(); i != m_observers.end(); ++i )
+        {
+            std::vector< int >::iterator j;
+            for ( j = i->cells.begin(); j != i->cells.end(); ++j )
+            {
+                m_seen[* j] -= 1;
+            }
+            if ( i->active )
+            {
+                _touch( i->origin );
+            }
+        }
+        Observer blind;
+        blind.active = false;
+        blind.origin.SetZero();
+        m_observers.assign( observers.size(), blind );
+        m_changed = true;
+    }
+
+    for ( unsigned int i = 0; i < observers.size(); ++i )
+    {
+        Observer & observer( m_observers[i] );
+        b2Vec2 origin( 0.0f, 0.0f );
+        bool active( _locate( observers[i], origin ) );
+        if ( active == observer.active &&
+             ( ! active || ( origin - observer.origin ).LengthSquared() <
+                           RECAST_DISTANCE * RECAST_DISTANCE ) )
+        {
+            continue;
+        }
+        std::vector< int >::iterator j;
+        for ( j = observer.cells.begin(); j != observer.cells.end(); ++j )
+        {
+            m_seen[* j] -= 1;
+        }
+        if ( observer.active )
+        {
+            _touch( observer.origin );
+        }
+        observer.cells.clear();
+        observer.active = active;
+        observer.origin = origin;
+        if ( active )
+        {
+            _cast( observer );
+            _touch( observer.origin );
+        }
+        m_changed = true;
+    }
+
+    m_bits.resize( ( entities.size() + 31 ) / 32, 0 );
+    for ( unsigned int i = 0; i < entities.size(); ++i )
+    {
+        Entity * entity( entities[i] );
+        if ( entity == 0 )
+        {
+            _setBit( i, false );
+        }
+        else if ( entity->getAllegiance() == ALLEGIANCE_ASSET )
+        {
+            _setBit( i, true );
+        }
+        else if ( entity->getContainer() != 0 )
+        {
+            continue;
+        }
+        else if ( entity->getBody()->IsStatic() )
+        {
+            if ( m_changed )
+            {
+                _setBit( i, _canSeeArea( entity->getAABB() ) );
+            }
+        }
+        else
+        {
+            _setBit( i, canSee( entity->getBody()->GetPosition() ) );
+        }
+    }
+
+    // Anyone inside a building or a car can be seen if it can.
+    for ( unsigned int i = 0; i < entities.size(); ++i )
+    {
+        Entity * entity( entities[i] );
+        if ( entity != 0 && entity->getContainer() != 0 &&
+             entity->getAllegiance() != ALLEGIANCE_ASSET )
+        {
+            Entity * host( entity->getContainer()->getContainerEntity() );
+            _setBit( i, isVisible( host ) );
+        }
+    }
+
+    m_changed = false;
+}
+
+//------------------------------------------------------------------------------
+bool
+Visibility::isVisible( Entity * entity )
+{
+    return isVisible( entity->getIndex() );
+}
+
+//------------------------------------------------------------------------------
+bool
+Visibility::isVisible( int index )
+{
+    if ( index < 0 || static_cast< unsigned int >( index / 32 ) >=
+                      m_bits.size() )
+    {
+        return false;
+    }
+    return ( m_bits[index / 32] & ( 1u << ( index % 32 ) ) ) != 0;
+}
+
+//------------------------------------------------------------------------------
+const std::vector< unsigned int > &
+Visibility::getBits()
+{
+    return m_bits;
+}
+
+//------------------------------------------------------------------------------
+bool
+Visibility::canSee( const b2Vec2 & point )
+{
+    int cell( cellAt( point ) );
+    return cell >= 0 && m_seen[cell] > 0;
+}
+
+//------------------------------------------------------------------------------
+bool
+Visibility::isSeen( int cell )
+{
+    return m_seen[cell] > 0;
+}
+
+//------------------------------------------------------------------------------
+// The cells that may have been seen or lost from view since we were last
+// cleaned, as an inclusive rectangle.
+bool
+Visibility::getDirty( int & left, int & top, int & right, int & bottom )
+{
+    if ( m_left > m_right || m_top > m_bottom )
+    {
+        return false;
+    }
+    left = m_left;
+    top = m_top;
+    right = m_right;
+    bottom = m_bottom;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void
+Visibility::clean()
+{
+    m_left = GRID_WIDTH;
+    m_top = GRID_HEIGHT;
+    m_right = -1;
+    m_bottom = -1;
+}
+
+//------------------------------------------------------------------------------
+int
+Visibility::getWidth()
+{
+    return GRID_WIDTH;
+}
+
+//------------------------------------------------------------------------------
+int
+Visibility::getHeight()
+{
+    return GRID_HEIGHT;
+}
+
+//------------------------------------------------------------------------------
+float
+Visibility::getCellSize()
+{
+    return CELL_SIZE;
+}
+
+//------------------------------------------------------------------------------
+int
+Visibility::cellAt( const b2Vec2 & point )
+{
+    float fx( ( point.x - WORLD_MIN ) / CELL_SIZE );
+    float fy( ( point.y - WORLD_MIN ) / CELL_SIZE );
+    if ( fx < 0.0f || fy < 0.0f )
+    {
+        return -1;
+    }
+    int x( static_cast< int >( fx ) );
+    int y( static_cast< int >( fy ) );
+    if ( x >= GRID_WIDTH || y >= GRID_HEIGHT )
+    {
+        return -1;
+    }
+    return y * GRID_WIDTH + x;
+}
+
+//------------------------------------------------------------------------------
+// private:
+//------------------------------------------------------------------------------
+// Squad members who have been taken out see nothing, and those who are inside
+// something see from wherever it is.
+bool
+Visibility::_locate( Guy * guy, b2Vec2 & origin )
+{
+    if ( guy->isDestroyed() )
+    {
+        return false;
+    }
+    Entity * host( guy );
+    if ( guy->getContainer() != 0 )
+    {
+        host = guy->getContainer()->getContainerEntity();
+    }
+    origin = host->getBody()->GetPosition();
+    return true;
+}
+
+//------------------------------------------------------------------------------
+void
+Visibility::_cast( Observer & observer )
+{
+    int origin( cellAt( observer.origin ) );
+    if ( origin < 0 )
+    {
+        return;
+    }
+
+    m_generation += 1;
+    if ( m_generation == 0 )
+    {
+        std::fill( m_stamp.begin(), m_stamp.end(), 0 );
+        m_generation = 1;
+    }
+
+    int cx( origin % GRID_WIDTH );
+    int cy( origin / GRID_WIDTH );
+    _reveal( origin, observer.cells );
+    for ( int i = 0; i < 8; ++i )
+    {
+        _castOctant( cx, cy, 1, 1.0f, 0.0f, OCTANT[0][i], OCTANT[1][i],
+                     OCTANT[2][i], OCTANT[3][i], observer.cells );
+    }
+
+    std::vector< int >::iterator i;
+    for ( i = observer.cells.begin(); i != observer.cells.end(); ++i )
+    {
+        m_seen[* i] += 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Recursive shadowcasting over one octant. Each row is scanned between the
+// slopes still in light, and whenever an opaque cell starts a run the part of
+// the view beyond it is handed off to the next row down before carrying on
+// past the shadow.
+void
+Visibility::_castOctant( int cx, int cy, int row, float start, float end,
+                         int xx, int xy, int yx, int yy,
+                         std::vector< int > & cells )
+{
+    if ( start < end )
+    {
+        return;
+    }
+    float next( start );
+    for ( int j = row; j <= SIGHT_RANGE; ++j )
+    {
+        bool blocked( false );
+        for ( int dx = -j, dy = -j; dx <= 0; ++dx )
+        {
+            float left( ( dx - 0.5f ) / ( dy + 0.5f ) );
+            float right( ( dx + 0.5f ) / ( dy - 0.5f ) );
+            if ( start < right )
+            {
+                continue;
+            }
+            if ( end > left )
+            {
+                break;
+            }
+
+            int x( cx + dx * xx + dy * xy );
+            int y( cy + dx * yx + dy * yy );
+            bool inside( x >= 0 && y >= 0 && x < GRID_WIDTH &&
+                         y < GRID_HEIGHT );
+            if ( inside && dx * dx + dy * dy <= SIGHT_RANGE * SIGHT_RANGE )
+            {
+                _reveal( y * GRID_WIDTH + x, cells );
+            }
+
+            bool opaque( ! inside || m_opaque[y * GRID_WIDTH + x] != 0 );
+            if ( blocked )
+            {
+                if ( opaque )
+                {
+                    next = right;
+                    continue;
+                }
+                blocked = false;
+                start = next;
+            }
+            else if ( opaque && j < SIGHT_RANGE )
+            {
+                blocked = true;
+                _castOctant( cx, cy, j + 1, start, left, xx, xy, yx, yy,
+                             cells );
+                next = right;
+            }
+        }
+        if ( blocked )
+        {
+            break;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+void
+Visibility::_reveal( int cell, std::vector< int > & cells )
+{
+    if ( m_stamp[cell] != m_generation )
+    {
+        m_stamp[cell] = m_generation;
+        cells.push_back( cell );
+    }
+}
+
+//------------------------------------------------------------------------------
+// Everything an observer can see lies within their range of where they stand.
+void
+Visibility::_touch( const b2Vec2 & origin )
+{
+    int cell( cellAt( origin ) );
+    if ( cell < 0 )
+    {
+        return;
+    }
+    int x( cell % GRID_WIDTH );
+    int y( cell / GRID_WIDTH );
+    m_left = std::max( 0, std::min( m_left, x - SIGHT_RANGE ) );
+    m_top = std::max( 0, std::min( m_top, y - SIGHT_RANGE ) );
+    m_right = std::min( GRID_WIDTH - 1, std::max( m_right, x + SIGHT_RANGE ) );
+    m_bottom = std::min( GRID_HEIGHT - 1,
+                         std::max( m_bottom, y + SIGHT_RANGE ) );
+}
+
+//------------------------------------------------------------------------------
+bool
+Visibility::_canSeeArea( const b2AABB & aabb )
+{
+    int x0( static_cast< int >( ( aabb.lowerBound.x - WORLD_MIN ) /
+                                CELL_SIZE ) );
+    int y0( static_cast< int >( ( aabb.lowerBound.y - WORLD_MIN ) /
+                                CELL_SIZE ) );
+    int x1( static_cast< int >( ( aabb.upperBound.x - WORLD_MIN ) /
+                                CELL_SIZE ) );
+    int y1( static_cast< int >( ( aabb.upperBound.y - WORLD_MIN ) /
+                                CELL_SIZE ) );
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 >= GRID_WIDTH ? GRID_WIDTH - 1 : x1;
+    y1 = y1 >= GRID_HEIGHT ? GRID_HEIGHT - 1 : y1;
+    for ( int y = y0; y <= y1; ++y )
+    {
+        for ( int x = x0; x <= x1; ++x )
+        {
+            if ( m_seen[y * GRID_WIDTH + x] > 0 )
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+void
+Visibility::_setBit( int index, bool visible )
+{
+    if ( visible )
+    {
+        m_bits[index / 32] |= 1u << ( index % 32 );
+    }
+    else
+    {
+        m_bits[index / 32] &= ~( 1u << ( index % 32 ) );
+    }
+}
+
+//==============================================================================
@@ -0,0 +1,88 @@
+//==============================================================================
+
+#ifndef ArseVisibility
+#define ArseVisibility
+
+#include <vector>
+
+#include <Box2D.h>
+
+class Entity;
+class Building;
+class Guy;
+
+//------------------------------------------------------------------------------
+// What the squad can see. Building footprints are rasterised onto a coarse
+// grid, and each squad member casts shadows across it out to the range of
+// their sight. Every cell keeps a count of the observers that can see it, so
+// an observer that moves only has to take back the cells it saw before and
+// hand out the ones it sees now, and an observer that hasn't moved far costs
+// nothing at all.
+//
+// Once the cells are up to date, every entity in the world gets a bit saying
+// whether the squad can see it, indexed the same way as the world cache. The
+// rectangle of cells that have changed is kept too, for the fog of war.
+class Visibility
+{
+  public:
+    Visibility();
+    ~Visibility();
+
+  private:
+    Visibility( const Visibility & );
+    Visibility & operator=( const Visibility & );
+
+    struct Observer
+    {
+        bool active;
+        b2Vec2 origin;
+        std::vector< int > cells;
+    };
+
+  public:
+    void bake( const std::vector< Building * > & buildings );
+    void clear();
+    void update( const std::vector< Guy * > & observers,
+                 const std::vector< Entity * > & entities );
+
+    bool isVisible( Entity * entity );
+    bool isVisible( int index );
+    const std::vector< unsigned int > & getBits();
+    bool canSee( const b2Vec2 & point );
+    bool isSeen( int cell );
+    bool getDirty( int & left, int & top, int & right, int & bottom );
+    void clean();
+
+    int getWidth();
+    int getHeight();
+    float getCellSize();
+    int cellAt( const b2Vec2 & point );
+
+  private:
+    bool _locate( Guy * guy, b2Vec2 & origin );
+    void _cast( Observer & observer );
+    void _castOctant( int cx, int cy, int row, float start, float end,
+                      int xx, int xy, int yx, int yy,
+                      std::vector< int > & cells );
+    void _reveal( int cell, std::vector< int > & cells );
+    void _touch( const b2Vec2 & origin );
+    bool _canSeeArea( const b2AABB & aabb );
+    void _setBit( int index, bool visible );
+
+  private:
+    std::vector< unsigned char > m_opaque;
+    std::vector< unsigned short > m_seen;
+    std::vector< unsigned int > m_stamp;
+    unsigned int m_generation;
+    std::vector< Observer > m_observers;
+    std::vector< unsigned int > m_bits;
+    bool m_changed;
+    int m_left;
+    int m_top;
+    int m_right;
+    int m_bottom;
+};
+
+#endif
+
+//==============================================================================